@@ -0,0 +1,266 @@
+.data
+	newline: .asciiz "\n"
+.text
+.globl clobber
+.ent clobber
+clobber:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	lw $s2, 8($fp)
+	li $s0, 1
+	sll $s6, $s0, 3
+	addu $s6, $s6, $s2
+	lw $t0, 0($s6)
+	sll $s6, $s0, 3
+	addu $s6, $s6, $s2
+	sw $t0, 4($s6)
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end clobber
+
+.globl weigh
+.ent weigh
+weigh:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	lw $s1, 8($fp)
+	add $s2, $zero, $s1
+	addi $s2, $s2, 64
+	li $t1, 0
+	li $s0, 0
+
+weigh_loop:
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 0($s6)
+	lw $t2, 12($fp)
+	mult $t2, $t0
+	mflo $t0
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s2
+	lw $t2, 0($s6)
+	add $t0, $t0, $t2
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	sw $t0, 128($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s2
+	lw $t2, 0($s6)
+	add $s0, $s0, $t2
+	add $s0, $s0, $t0
+	addi $t1, $t1, 1
+	lw $t2, 16($fp)
+	blt $t1, $t2, weigh_loop
+
+	add $t0, $zero, $s0
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end weigh
+
+.globl main
+.ent main
+main:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	addi $sp, $sp, -256
+	add $s1, $zero, $sp
+	li $t1, 0
+
+main_fill:
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	sw $t1, 0($s6)
+	add $t0, $zero, $t1
+	add $t0, $t0, $t1
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	sw $t0, 64($s6)
+	addi $t1, $t1, 1
+	blt $t1, 8, main_fill
+
+	li $t1, 3
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 0($s6)
+	addi $t1, $t1, 1
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	sw $t0, 0($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t1, 0($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 64($s6)
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	li $t1, 1
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 0($s6)
+	addi $s1, $s1, 4
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t2, 0($s6)
+	addi $s1, $s1, -4
+	add $t0, $t0, $t2
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	li $t1, 2
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 0($s6)
+	sll $s6, $t0, 2
+	addu $t0, $s6, $t0
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	sw $t0, 0($s6)
+	addi $s6, $zero, 268500992
+	lw $t2, ($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	sw $t2, 4($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 0($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t2, 4($s6)
+	add $t0, $t0, $t2
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	li $t1, 5
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	li $s7, 9
+	sw $s7, 0($s6)
+	addi $sp, $sp, -4
+	sw $s1, 0($sp)
+	jal clobber
+	addi $sp, $sp, 4
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t0, 0($s6)
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t2, 0($s6)
+	add $t0, $t0, $t2
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	add $s2, $zero, $s1
+	addi $s2, $s2, 128
+	li $t1, 4
+	li $t2, 8
+	addu $s6, $t1, $s1
+	li $s7, 1
+	sw $s7, 0($s6)
+	sll $s6, $t1, 1
+	addu $s6, $s6, $s1
+	li $s7, 2
+	sw $s7, 64($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	li $s7, 3
+	sw $s7, 128($s6)
+	sll $s6, $t1, 3
+	addu $s6, $s6, $s1
+	li $s7, 4
+	sw $s7, 96($s6)
+	addu $s6, $t2, $s1
+	li $s7, 5
+	sw $s7, 160($s6)
+	sll $s6, $t2, 1
+	addu $s6, $s6, $s1
+	li $s7, 6
+	sw $s7, 192($s6)
+	sll $s6, $t2, 2
+	addu $s6, $s6, $s1
+	li $s7, 7
+	sw $s7, 8($s6)
+	sll $s6, $t2, 3
+	addu $s6, $s6, $s1
+	li $s7, 8
+	sw $s7, 176($s6)
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s2
+	li $s7, 9
+	sw $s7, 48($s6)
+	add $s6, $s1, $t1
+	lw $t0, 0($s6)
+	sll $s6, $t1, 1
+	addu $s6, $s6, $s1
+	lw $t2, 64($s6)
+	add $t0, $t0, $t2
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s1
+	lw $t2, 128($s6)
+	add $t0, $t0, $t2
+	sll $s6, $t1, 3
+	addu $s6, $s6, $s1
+	lw $t2, 96($s6)
+	add $t0, $t0, $t2
+	sll $s6, $t1, 2
+	addu $s6, $s6, $s2
+	lw $t2, 48($s6)
+	add $t0, $t0, $t2
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	addi $sp, $sp, -4
+	li $s7, 8
+	sw $s7, 0($sp)
+	addi $sp, $sp, -4
+	li $s7, 3
+	sw $s7, 0($sp)
+	addi $sp, $sp, -4
+	sw $s1, 0($sp)
+	jal weigh
+	addi $sp, $sp, 12
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	addi $sp, $sp, 256
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end main
+
@@ -66,10 +66,10 @@ test5:
 	sw $ra, 4($sp)
 	sw $fp, 0($sp)
 	addi $fp, $sp, 0
-	addi $s6, $zero, 10
-	mult $s6, $t1
-	mflo $s6
-	add $s6, $s6, $s0
+	sll $s6, $t1, 2
+	addu $s6, $s6, $t1
+	sll $s6, $s6, 1
+	addu $s6, $s6, $s0
 	sw $t0, 3($s6)
 	lw $fp, 0($sp)
 	lw $ra, 4($sp)
@@ -145,10 +145,8 @@ test10:
 	sw $ra, 4($sp)
 	sw $fp, 0($sp)
 	addi $fp, $sp, 0
-	addi $s6, $zero, 8
-	mult $s6, $s0
-	mflo $s6
-	add $s6, $s6, $t0
+	sll $s6, $s0, 3
+	addu $s6, $s6, $t0
 	li $s7, 2
 	sw $s7, 0($s6)
 	lw $fp, 0($sp)
@@ -208,10 +206,7 @@ test14:
 	sw $ra, 4($sp)
 	sw $fp, 0($sp)
 	addi $fp, $sp, 0
-	addi $s6, $zero, 8
-	mult $s6, $t1
-	mflo $s6
-	add $s6, $s6, $zero
+	sll $s6, $t1, 3
 	lw $s0, 5($s6)
 	lw $fp, 0($sp)
 	lw $ra, 4($sp)
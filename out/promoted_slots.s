@@ -0,0 +1,234 @@
+.data
+	newline: .asciiz "\n"
+.text
+.globl square
+.ent square
+square:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	lw $t0, 8($fp)
+	mult $t0, $t0
+	mflo $t0
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end square
+
+.globl squares
+.ent squares
+squares:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	addi $sp, $sp, -24
+	li $s7, 0
+	sw $s7, -4($fp)
+	li $s7, 0
+	sw $s7, -8($fp)
+	li $s7, 0
+	sw $s7, -12($fp)
+	li $s7, 0
+	sw $s7, -16($fp)
+	li $s7, 0
+	sw $s7, -24($fp)
+	add $s7, $zero, 7
+	sw $s7, -24($fp)
+
+squares_outer:
+	lw $t0, -8($fp)
+	addi $sp, $sp, -4
+	sw $t0, 0($sp)
+	jal square
+	addi $sp, $sp, 4
+	lw $s7, -4($fp)
+	add $t0, $t0, $s7
+	sw $t0, -4($fp)
+	li $s7, 0
+	sw $s7, -20($fp)
+
+squares_inner:
+	lw $t0, -12($fp)
+	lw $s7, -20($fp)
+	add $t0, $t0, $s7
+	sw $t0, -12($fp)
+	lw $t2, -16($fp)
+	addi $t2, $t2, 1
+	sw $t2, -16($fp)
+	lw $t2, -24($fp)
+	xori $t2, $t2, 1
+	sw $t2, -24($fp)
+	lw $t1, -20($fp)
+	addi $t1, $t1, 1
+	sw $t1, -20($fp)
+	blt $t1, 3, squares_inner
+
+	lw $t1, -8($fp)
+	addi $t1, $t1, 1
+	sw $t1, -8($fp)
+	lw $t2, 8($fp)
+	blt $t1, $t2, squares_outer
+
+	lw $t0, -12($fp)
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	lw $t0, -16($fp)
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	lw $t0, -24($fp)
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	lw $t0, -4($fp)
+	addi $sp, $sp, 24
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end squares
+
+.globl depth
+.ent depth
+depth:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	addi $sp, $sp, -8
+	li $s7, 0
+	sw $s7, -4($fp)
+	li $s7, 0
+	sw $s7, -8($fp)
+
+depth_loop:
+	lw $t0, -4($fp)
+	lw $s7, -8($fp)
+	add $t0, $t0, $s7
+	sw $t0, -4($fp)
+	lw $t1, -8($fp)
+	addi $t1, $t1, 1
+	sw $t1, -8($fp)
+	blt $t1, 4, depth_loop
+
+	lw $t0, 8($fp)
+	beq $t0, 0, depth_end
+
+	addi $t0, $t0, -1
+	addi $sp, $sp, -4
+	sw $t0, 0($sp)
+	jal depth
+	addi $sp, $sp, 4
+	lw $s7, -4($fp)
+	add $t0, $t0, $s7
+	sw $t0, -4($fp)
+
+depth_end:
+	lw $t0, -4($fp)
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	addi $sp, $sp, 8
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end depth
+
+.globl scale
+.ent scale
+scale:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	addi $sp, $sp, -8
+	li $s7, 0
+	sw $s7, -4($fp)
+	lw $t1, 8($fp)
+	sw $t1, -8($fp)
+
+scale_loop:
+	lw $t0, -4($fp)
+	lw $s7, 12($fp)
+	add $t0, $t0, $s7
+	sw $t0, -4($fp)
+	lw $s7, -8($fp)
+	addi $s7, $s7, -1
+	sw $s7, -8($fp)
+	lw $t2, -8($fp)
+	bgt $t2, 0, scale_loop
+
+	lw $t0, -4($fp)
+	addi $sp, $sp, 8
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end scale
+
+.globl main
+.ent main
+main:
+	addi $sp, $sp, -8
+	sw $ra, 4($sp)
+	sw $fp, 0($sp)
+	addi $fp, $sp, 0
+	addi $sp, $sp, -4
+	li $s7, 4
+	sw $s7, 0($sp)
+	jal squares
+	addi $sp, $sp, 4
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	addi $sp, $sp, -4
+	li $s7, 3
+	sw $s7, 0($sp)
+	jal depth
+	addi $sp, $sp, 4
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	addi $sp, $sp, -4
+	li $s7, 3
+	sw $s7, 0($sp)
+	addi $sp, $sp, -4
+	li $s7, 5
+	sw $s7, 0($sp)
+	jal scale
+	addi $sp, $sp, 8
+	add $a0, $zero, $t0
+	li $v0, 1
+	syscall
+	li $v0, 4
+	la $a0, newline
+	syscall
+	lw $fp, 0($sp)
+	lw $ra, 4($sp)
+	add $sp, $sp, 8
+	jr $ra
+.end main
+
@@ -49,10 +49,8 @@ access:
 	sw $fp, 0($sp)
 	addi $fp, $sp, 0
 	li $s0, 4
-	addi $s6, $zero, 4
-	mult $s6, $s0
-	mflo $s6
-	add $s6, $s6, $fp
+	sll $s6, $s0, 2
+	addu $s6, $s6, $fp
 	lw $t1, 0($s6)
 	lw $fp, 0($sp)
 	lw $ra, 4($sp)
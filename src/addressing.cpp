@@ -0,0 +1,115 @@
+#include "addressing.h"
+#include "liveness.h"
+#include "promotion.h"
+
+// the operand of instruction i whose address the translation computes into
+// an address register, -1 for none: only movl takes indexed operands, and
+// a scaled index of 1 without a base is used as it is
+static int address_operand(const program& prog, uint32_t i) {
+	if (prog.get_opcode(i) != OP_MOVL) {
+		return -1;
+	}
+	operand_desc operand1 = prog.get_operand(i, 0);
+	operand_desc operand2 = prog.get_operand(i, 1);
+	int n;
+	if (operand1.is_memory() && operand2.kind == OPERAND_REGISTER) {
+		n = 0;
+	} else if (operand2.is_memory() && (operand1.kind == OPERAND_REGISTER || operand1.kind == OPERAND_IMMEDIATE)) {
+		n = 1;
+	} else {
+		return -1;
+	}
+	operand_desc operand = n == 0 ? operand1 : operand2;
+	bool computed = operand.kind == OPERAND_INDEXED
+		|| (operand.kind == OPERAND_SCALED_INDEXED && !(operand.scale == 1 && operand.base == REG_NONE));
+	return computed ? n : -1;
+}
+
+// whether the translation of instruction i uses $s6 for something else
+static bool clobbers_s6(const program& prog, uint32_t i) {
+	operand_desc operand1 = prog.get_operand(i, 0);
+	operand_desc operand2 = prog.get_operand(i, 1);
+	switch (prog.get_opcode(i)) {
+		case OP_MOVL: return operand1.kind == OPERAND_ABSOLUTE || operand2.kind == OPERAND_ABSOLUTE;
+		case OP_IMULL: return operand1.kind == OPERAND_IMMEDIATE;
+		default: return false;
+	}
+}
+
+address_reuse::address_reuse(const program& prog) : prog(prog), uses(prog.instruction_count(), address_use{0, true}) {
+	for (uint32_t b = 0; b < prog.block_count(); b++) {
+		analyze_block(b);
+	}
+}
+
+void address_reuse::analyze_block(uint32_t b) {
+	uint32_t first = prog.get_block_first(b), last = prog.get_block_last(b);
+	if (first == last) {
+		return;
+	}
+
+	// $t3-$t9 hold promoted slots in some procedures
+	bool usable[REGISTER_COUNT];
+	for (int r = 0; r < REGISTER_COUNT; r++) {
+		usable[r] = true;
+	}
+	if (const frame_plan* plan = prog.get_frame_plan(first)) {
+		for (auto slot = plan->slots.begin(); slot != plan->slots.end(); slot++) {
+			int r = frame_promotion::REGISTER_COUNT - slot->reg;
+			if (r >= 1 && r < REGISTER_COUNT) {
+				usable[r] = false;
+			}
+		}
+	}
+
+	held_address held[REGISTER_COUNT] = {};
+	for (uint32_t i = first; i < last; i++) {
+		int n = address_operand(prog, i);
+		if (n >= 0) {
+			operand_desc operand = prog.get_operand(i, n);
+			uint8_t scale = operand.kind == OPERAND_INDEXED ? 1 : operand.scale;
+			int found = -1, replaced = -1;
+			for (int r = 0; r < REGISTER_COUNT && found < 0; r++) {
+				if (!usable[r]) {
+					continue;
+				}
+				if (held[r].valid && held[r].base == operand.base && held[r].index == operand.index && held[r].scale == scale) {
+					found = r;
+				} else if (replaced < 0 || (held[replaced].valid && (!held[r].valid || held[r].last_use < held[replaced].last_use))) {
+					replaced = r;
+				}
+			}
+			if (found >= 0) {
+				uses[i] = {(uint8_t) found, false};
+			} else {
+				found = replaced;
+				held[found] = {true, (uint8_t) operand.base, (uint8_t) operand.index, scale, 0};
+				uses[i] = {(uint8_t) found, true};
+			}
+			held[found].last_use = i;
+		}
+
+		// what the instruction's code writes
+		opcode_id op = prog.get_opcode(i);
+		if (op == OP_CALL || op == OP_LEAVE || op == OP_RET || op == OP_PRN || op == OP_INT) {
+			for (int r = 0; r < REGISTER_COUNT; r++) {
+				held[r].valid = false;
+			}
+			continue;
+		}
+		register_set reads, writes;
+		register_effects(prog, i, reads, writes);
+		for (int r = 0; r < REGISTER_COUNT; r++) {
+			if (writes & (register_bit((register_id) held[r].base) | register_bit((register_id) held[r].index))) {
+				held[r].valid = false;
+			}
+		}
+		if (clobbers_s6(prog, i)) {
+			held[0].valid = false;
+		}
+	}
+}
+
+vector<address_use>& address_reuse::get_uses() {
+	return uses;
+}
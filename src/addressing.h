@@ -0,0 +1,47 @@
+#ifndef ADDRESSING_H
+#define ADDRESSING_H
+
+#include <vector>
+#include "program.h"
+
+using namespace std;
+
+// Decides, within each block, which address register the translation of an
+// indexed or scaled indexed movl operand computes its address into, and
+// when a register still holds the same base, index and scale from an
+// earlier instruction, so the add or sll/addu is left out. The displacement
+// stays in the memory operand and does not matter.
+//
+// $s6 is always an address register; $t9 down to $t3 are used as well, the
+// reverse of the order promotion hands them out in, except those the
+// procedure's frame plan promotes slots to. The least recently
+// used one is replaced. A register is dropped when its base or index is
+// written, and all are at calls, leave, ret, prn and int, whose code or
+// callee may use them; $s6 also when an absolute operand or an imull by an
+// immediate uses it. Nothing is kept from one block to the next
+class address_reuse {
+public:
+	static const int REGISTER_COUNT = 8; // $s6, then $t9-$t3
+
+private:
+	struct held_address {
+		bool valid;
+		uint8_t base;
+		uint8_t index;
+		uint8_t scale;
+		uint32_t last_use;
+	};
+
+	const program& prog;
+	vector<address_use> uses;
+
+	void analyze_block(uint32_t b);
+
+public:
+	address_reuse(const program& prog);
+
+	// hands the per instruction uses over, e.g. to program::set_address_uses
+	vector<address_use>& get_uses();
+};
+
+#endif
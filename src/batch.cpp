@@ -0,0 +1,168 @@
+#include "batch.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <mutex>
+#include <chrono>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "parser.h"
+#include "thread_pool.h"
+#include "encoder.h"
+
+bool write_block_map(translator& translator, parser& parser, const string& output_path, string& error) {
+	string map_path = output_path + ".blocks";
+	ofstream map(map_path);
+	translator.write_block_map(parser, map);
+	map.close();
+	if (!map) {
+		error = "error writing " + map_path;
+		return false;
+	}
+	return true;
+}
+
+bool write_binary(const string& assembly, const string& output_path, string& error) {
+	mips_encoder encoder;
+	if (!encoder.assemble(assembly, error)) {
+		error = output_path + ": " + error;
+		return false;
+	}
+	ofstream text(output_path + ".text", ios::binary), data(output_path + ".data", ios::binary), symbols(output_path + ".sym");
+	encoder.write_text(text);
+	encoder.write_data(data);
+	encoder.write_symbols(symbols);
+	text.close();
+	data.close();
+	symbols.close();
+	if (!text || !data || !symbols) {
+		error = "error writing " + output_path + ".text, .data or .sym";
+		return false;
+	}
+	return true;
+}
+
+bool translate_file(translator& translator, const string& input_path, const string& output_path,
+		bool use_mmap, bool binary, string& error) {
+	try {
+		translation_stats* stats = translator.get_stats();
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		parser parser(input_path, use_mmap);
+		if (!parser.is_loaded()) {
+			error = "cannot read " + input_path;
+			return false;
+		}
+		if (stats != NULL) {
+			stats->add_parse_time(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		}
+
+		if (binary) {
+			ostringstream assembly;
+			translator.translate_IA32_to_MIPS(parser, assembly);
+			if (!write_binary(assembly.str(), output_path, error)) {
+				return false;
+			}
+		} else {
+			ofstream os(output_path);
+			if (!os) {
+				error = "cannot write " + output_path;
+				return false;
+			}
+			translator.translate_IA32_to_MIPS(parser, os);
+			start = chrono::steady_clock::now();
+			os.close();
+			if (stats != NULL) {
+				stats->add_write_time(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+			}
+			if (!os) {
+				error = "error writing " + output_path;
+				return false;
+			}
+		}
+		if (translator.get_instrument() && !write_block_map(translator, parser, output_path, error)) {
+			return false;
+		}
+	} catch (const exception& e) {
+		error = input_path + ": " + e.what();
+		return false;
+	}
+	return true;
+}
+
+static bool has_suffix(const string& name, const string& suffix) {
+	return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool jobs_from_directory(const string& input_dir, const string& output_dir, vector<batch_job>& jobs, string& error) {
+	DIR* dir = opendir(input_dir.c_str());
+	if (dir == NULL) {
+		error = "cannot open directory " + input_dir;
+		return false;
+	}
+
+	vector<string> names;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		string name(entry->d_name);
+		if (has_suffix(name, ".s")) {
+			names.push_back(name);
+		}
+	}
+	closedir(dir);
+	sort(names.begin(), names.end());
+
+	mkdir(output_dir.c_str(), 0755);
+	for (auto name = names.begin(); name != names.end(); name++) {
+		jobs.push_back({input_dir + "/" + *name, output_dir + "/" + *name});
+	}
+	return true;
+}
+
+bool jobs_from_manifest(const string& manifest_path, vector<batch_job>& jobs, string& error) {
+	ifstream manifest(manifest_path);
+	if (!manifest) {
+		error = "cannot read manifest " + manifest_path;
+		return false;
+	}
+
+	string line;
+	int line_number = 0;
+	while (getline(manifest, line)) {
+		line_number++;
+		line = line.substr(0, line.find('#'));
+
+		istringstream iss(line);
+		batch_job job;
+		if (!(iss >> job.input_path)) {
+			continue; // blank line
+		}
+		if (!(iss >> job.output_path)) {
+			error = manifest_path + ":" + to_string(line_number) + ": missing output path";
+			return false;
+		}
+		jobs.push_back(job);
+	}
+	return true;
+}
+
+// translate_IA32_to_MIPS leaves the translator untouched, one serves all workers
+int run_batch(const vector<batch_job>& jobs, translator& translator, bool use_mmap, bool binary, size_t thread_count) {
+	mutex report_lock;
+	int failures = 0;
+
+	thread_pool pool(thread_count);
+	for (auto job = jobs.begin(); job != jobs.end(); job++) {
+		pool.submit([&, job] {
+			string error;
+			if (!translate_file(translator, job->input_path, job->output_path, use_mmap, binary, error)) {
+				lock_guard<mutex> guard(report_lock);
+				cerr << "Error: " << error << endl;
+				failures++;
+			}
+		});
+	}
+	pool.wait();
+
+	return failures;
+}
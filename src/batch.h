@@ -0,0 +1,34 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include "translator.h"
+
+using namespace std;
+
+struct batch_job {
+	string input_path;
+	string output_path;
+};
+
+// the counter map of an instrumented translation, written next to it as output_path.blocks
+bool write_block_map(translator& translator, parser& parser, const string& output_path, string& error);
+// assembles a translation to machine code, written as output_path.text,
+// output_path.data and output_path.sym
+bool write_binary(const string& assembly, const string& output_path, string& error);
+// translates one file, on failure returns false and describes it in error.
+// With binary the machine code is written instead of the assembly
+bool translate_file(translator& translator, const string& input_path, const string& output_path,
+		bool use_mmap, bool binary, string& error);
+
+// every *.s file in input_dir, written under the same name to output_dir
+bool jobs_from_directory(const string& input_dir, const string& output_dir, vector<batch_job>& jobs, string& error);
+// one "input output" pair per line, blank lines and # comments are skipped
+bool jobs_from_manifest(const string& manifest_path, vector<batch_job>& jobs, string& error);
+
+// translates all jobs concurrently with the one translator, reports each
+// failure on stderr and returns the number of failed jobs
+int run_batch(const vector<batch_job>& jobs, translator& translator, bool use_mmap, bool binary, size_t thread_count);
+
+#endif
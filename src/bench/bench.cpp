@@ -0,0 +1,145 @@
+// Measures the translator phase by phase on the given inputs: parsing,
+// translate_IA32_to_MIPS into memory, and writing the result to a file.
+// Each phase reports its time, lines and bytes per second, and the peak
+// RSS reached during it (the kernel's high water mark is reset between
+// phases where /proc/self/clear_refs allows it).
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <stdlib.h>
+#include <string.h>
+#include "../parser.h"
+#include "../translator.h"
+#include "../scanner.h"
+
+using namespace std;
+
+// resets the peak RSS to the current RSS, false if the kernel does not allow it
+static bool reset_peak_rss() {
+	ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.close();
+	return !clear_refs.fail();
+}
+
+// VmHWM in kilobytes, which reset_peak_rss lowers unlike getrusage
+static size_t phase_peak_rss_kb() {
+	ifstream status("/proc/self/status");
+	string line;
+	while (getline(status, line)) {
+		if (line.compare(0, 6, "VmHWM:") == 0) {
+			return strtoull(line.c_str() + 6, NULL, 10);
+		}
+	}
+	return 0;
+}
+
+struct phase_result {
+	const char* name;
+	double seconds;
+	size_t lines;
+	size_t bytes;
+	size_t peak_kb;
+};
+
+static void report(const string& input, const vector<phase_result>& phases, bool peak_per_phase) {
+	cout << input << (peak_per_phase ? "" : " (peak RSS is cumulative)") << endl;
+	for (auto phase = phases.begin(); phase != phases.end(); phase++) {
+		double seconds = max(phase->seconds, 1e-9);
+		cout << "  " << left << setw(10) << phase->name << right << fixed
+			<< setprecision(3) << setw(9) << phase->seconds << " s"
+			<< setprecision(0) << setw(13) << phase->lines / seconds << " lines/s"
+			<< setprecision(1) << setw(9) << phase->bytes / seconds / (1024 * 1024) << " MB/s"
+			<< setw(9) << phase->peak_kb / 1024.0 << " MB peak RSS" << endl;
+	}
+}
+
+static size_t count_lines(const string& text) {
+	return count(text.begin(), text.end(), '\n');
+}
+
+// size and line count of a file, read in chunks so the input does not count towards parse's peak
+static size_t file_size(const string& path, size_t& lines) {
+	ifstream in(path, ios::binary);
+	vector<char> buffer(64 * 1024);
+	size_t size = 0;
+	lines = 0;
+	while (in.read(&buffer[0], buffer.size()) || in.gcount() > 0) {
+		size_t got = in.gcount();
+		lines += count(buffer.begin(), buffer.begin() + got, '\n');
+		size += got;
+	}
+	return size;
+}
+
+int main(int argc, char* argv[]) {
+	bool use_mmap = false;
+	size_t thread_count = 1;
+	string output_path = "/tmp/IA32toMISP_bench.s";
+	vector<string> inputs;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--mmap") == 0) {
+			use_mmap = true;
+		} else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			thread_count = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else {
+			inputs.push_back(argv[i]);
+		}
+	}
+	if (inputs.empty()) {
+		cout << "Usage: IA32toMISP_bench [--mmap] [--jobs n] [--output file] input ..." << endl;
+		return -1;
+	}
+
+	cout << "line scanner: " << line_scanner::kernel_name() << endl;
+	translator translator;
+	unique_ptr<thread_pool> pool;
+	if (thread_count != 1) {
+		pool.reset(new thread_pool(thread_count));
+	}
+
+	for (auto input = inputs.begin(); input != inputs.end(); input++) {
+		size_t input_lines;
+		size_t input_bytes = file_size(*input, input_lines);
+		vector<phase_result> phases;
+		bool peak_per_phase = reset_peak_rss();
+		typedef chrono::steady_clock clock;
+
+		clock::time_point start = clock::now();
+		parser parser(*input, use_mmap);
+		if (!parser.is_loaded()) {
+			cerr << "Error reading " << *input << endl;
+			return 1;
+		}
+		double parse_seconds = chrono::duration<double>(clock::now() - start).count();
+		phases.push_back({"parse", parse_seconds, input_lines, input_bytes, phase_peak_rss_kb()});
+
+		reset_peak_rss();
+		ostringstream translated;
+		start = clock::now();
+		translator.translate_IA32_to_MIPS(parser, translated, pool.get());
+		string text = translated.str();
+		double translate_seconds = chrono::duration<double>(clock::now() - start).count();
+		phases.push_back({"translate", translate_seconds, input_lines, input_bytes, phase_peak_rss_kb()});
+
+		reset_peak_rss();
+		start = clock::now();
+		{
+			ofstream os(output_path, ios::binary);
+			os.write(text.data(), text.size());
+		}
+		double write_seconds = chrono::duration<double>(clock::now() - start).count();
+		phases.push_back({"write", write_seconds, count_lines(text), text.size(), phase_peak_rss_kb()});
+
+		report(*input, phases, peak_per_phase);
+	}
+	return 0;
+}
@@ -0,0 +1,165 @@
+// Writes a synthetic IA32 program of about the requested number of lines,
+// for measuring the translator on inputs far larger than tst/. The mix
+// follows the hand-written tests: procedures with a frame, movl in every
+// addressing mode, arithmetic, pushl batches passing call arguments,
+// cmpl/jcc pairs forming loops and forward branches, and prn.
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+using namespace std;
+
+static const char* const REGISTERS[] = {"%eax", "%ebx", "%ecx", "%edx", "%esi", "%edi"};
+static const char* const JUMPS[] = {"je", "jne", "jl", "jle", "jg", "jge"};
+static const char* const ARITHMETIC[] = {"addl", "subl", "andl", "orl", "xorl"};
+
+// small xorshift generator, the same seed gives the same program everywhere
+class generator {
+private:
+	uint64_t state;
+
+public:
+	generator(uint64_t seed) : state(seed * 2654435761ULL + 1) {}
+
+	uint32_t next() {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		return (uint32_t) state;
+	}
+
+	int below(int n) {
+		return next() % n;
+	}
+
+	const char* reg() {
+		return REGISTERS[below(6)];
+	}
+};
+
+static size_t write_instruction(ostream& os, generator& gen, int procedure, int& label_count) {
+	int kind = gen.below(100);
+	if (kind < 30) { // movl in the addressing modes of tst/addressing.s
+		switch (gen.below(8)) {
+			case 0: os << "\tmovl " << gen.reg() << ", " << gen.reg() << "\n"; break;
+			case 1: os << "\tmovl $" << gen.below(1000) << ", " << gen.reg() << "\n"; break;
+			case 2: os << "\tmovl " << 8 + 4 * gen.below(4) << "(%ebp), " << gen.reg() << "\n"; break;
+			case 3: os << "\tmovl " << gen.reg() << ", -" << 4 + 4 * gen.below(4) << "(%ebp)\n"; break;
+			case 4: os << "\tmovl $" << gen.below(100) << ", " << 4 * gen.below(8) << "(" << gen.reg() << ")\n"; break;
+			case 5: os << "\tmovl " << 4 * gen.below(4) << "(" << gen.reg() << ", " << gen.reg() << "), " << gen.reg() << "\n"; break;
+			case 6: os << "\tmovl (" << gen.reg() << ", " << gen.reg() << ", " << (1 << gen.below(4)) << "), " << gen.reg() << "\n"; break;
+			default: os << "\tmovl " << gen.reg() << ", " << 4 * gen.below(4) << "(" << gen.reg() << ", " << gen.reg() << ", 4)\n"; break;
+		}
+		return 1;
+	}
+	if (kind < 50) {
+		const char* op = ARITHMETIC[gen.below(5)];
+		if (gen.below(2) == 0) {
+			os << "\t" << op << " " << gen.reg() << ", " << gen.reg() << "\n";
+		} else {
+			os << "\t" << op << " $" << gen.below(64) << ", " << gen.reg() << "\n";
+		}
+		return 1;
+	}
+	if (kind < 58) {
+		switch (gen.below(4)) {
+			case 0: os << "\timull " << gen.reg() << ", " << gen.reg() << "\n"; break;
+			case 1: os << "\timull $" << 1 + gen.below(12) << ", " << gen.reg() << "\n"; break;
+			case 2: os << "\tsall $" << 1 + gen.below(4) << ", " << gen.reg() << "\n"; break;
+			default: os << "\tcltd\n\tidivl %ebx\n"; return 2;
+		}
+		return 1;
+	}
+	if (kind < 66) {
+		os << "\t" << (gen.below(2) == 0 ? "incl " : "decl ") << gen.reg() << "\n";
+		return 1;
+	}
+	if (kind < 78 && procedure > 0) { // call an earlier procedure with arguments
+		int argument_count = gen.below(4);
+		for (int i = 0; i < argument_count; i++) {
+			if (gen.below(2) == 0) {
+				os << "\tpushl " << gen.reg() << "\n";
+			} else {
+				os << "\tpushl $" << gen.below(100) << "\n";
+			}
+		}
+		os << "\tcall proc" << gen.below(procedure) << "\n"; // pops the arguments, as translated
+		return argument_count + 1;
+	}
+	if (kind < 82) {
+		os << "\tpushl " << gen.reg() << "\n\tpopl " << gen.reg() << "\n";
+		return 2;
+	}
+	if (kind < 95) { // a forward branch over the next label
+		os << "\tcmpl $" << gen.below(50) << ", " << gen.reg() << "\n";
+		os << "\t" << JUMPS[gen.below(6)] << " p" << procedure << "_l" << label_count << "\n";
+		return 2;
+	}
+	os << "\tprn " << gen.reg() << "\n";
+	return 1;
+}
+
+// a procedure of about body_lines lines, with a loop around part of it
+static size_t write_procedure(ostream& os, generator& gen, int procedure, const string& name, size_t body_lines) {
+	size_t lines = 0;
+	int label_count = 0;
+	os << name << ":\n\tpushl %ebp\n\tmovl %esp, %ebp\n";
+	lines += 3;
+
+	os << "\tmovl $0, %esi\n";
+	os << "p" << procedure << "_loop:\n";
+	lines += 2;
+	while (lines < body_lines) {
+		lines += write_instruction(os, gen, procedure, label_count);
+		if (gen.below(8) == 0) { // the target of the forward branches so far
+			os << "p" << procedure << "_l" << label_count++ << ":\n";
+			lines++;
+		}
+	}
+	os << "p" << procedure << "_l" << label_count << ":\n";
+	os << "\tincl %esi\n\tcmpl $10, %esi\n\tjl p" << procedure << "_loop\n";
+	os << "\tleave\n\tret\n\n";
+	return lines + 7;
+}
+
+int main(int argc, char* argv[]) {
+	size_t line_target = 100000;
+	size_t procedure_lines = 200;
+	uint64_t seed = 1;
+	const char* output_path = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+			line_target = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--procedure-lines") == 0 && i + 1 < argc) {
+			procedure_lines = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = strtoull(argv[++i], NULL, 10);
+		} else {
+			output_path = argv[i];
+		}
+	}
+	if (output_path == NULL || procedure_lines < 10) {
+		cout << "Usage: gen_input [--lines n] [--procedure-lines n] [--seed n] output_file" << endl;
+		return -1;
+	}
+
+	ofstream os(output_path);
+	if (!os) {
+		cerr << "Error writing to " << output_path << endl;
+		return -1;
+	}
+	generator gen(seed);
+	size_t lines = 0;
+	int procedure = 0;
+	while (lines + procedure_lines < line_target) {
+		string name = "proc" + to_string(procedure);
+		lines += write_procedure(os, gen, procedure, name, procedure_lines);
+		procedure++;
+	}
+	lines += write_procedure(os, gen, procedure, "main", procedure_lines);
+	cerr << "gen_input: " << lines << " lines, " << procedure + 1 << " procedures" << endl;
+	return 0;
+}
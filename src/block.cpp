@@ -1,21 +1,20 @@
 #include "block.h"
+#include "program.h"
 
-block::block(string label) : label(label) {}
+block::block(const program* prog, uint32_t index) : prog(prog), index(index) {}
 
-string block::get_label() {
-	return label;
+uint32_t block::get_index() {
+	return index;
 }
 
-vector<instruction*> block::get_instructions() {
-	return instructions;
+text_ref block::get_label() {
+	return prog->get_block_label(index);
 }
 
-void block::push_back_instruction(instruction* instr) {
-	instructions.push_back(instr);
+uint32_t block::get_line() {
+	return prog->get_block_line(index);
 }
 
-block::~block() {
-	for (auto instr = instructions.begin(); instr != instructions.end(); instr++) {
-		delete *instr;
-	}
+index_range<instruction> block::get_instructions() {
+	return prog->get_instructions(prog->get_block_first(index), prog->get_block_last(index));
 }
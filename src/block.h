@@ -1,25 +1,29 @@
 #ifndef BLOCK_H
 #define BLOCK_H
 
-#include <string>
-#include <vector>
+#include <stdint.h>
+#include "text_ref.h"
 #include "instruction.h"
+#include "index_range.h"
 
 using namespace std;
 
+class program;
+
+// handle of a labeled run of instructions stored in a program
 class block {
 private:
-	string label;
-	vector<instruction*> instructions;
+	const program* prog;
+	uint32_t index;
 
 public:
-	block(string label);
-
-	string get_label();
-	vector<instruction*> get_instructions();
-	void push_back_instruction(instruction* instr);
+	block(const program* prog, uint32_t index);
 
-	~block();
+	uint32_t get_index();
+	text_ref get_label();
+	// line of the label in the input, counting from 1
+	uint32_t get_line();
+	index_range<instruction> get_instructions();
 };
 
 #endif 
@@ -0,0 +1,140 @@
+#include "cache.h"
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <dirent.h>
+#include <utime.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char* const ENTRY_MAGIC = "IA32toMIPS cache 1";
+
+// 64 bit FNV-1a
+uint64_t hash_text(const string& text) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < text.size(); i++) {
+		hash ^= (unsigned char) text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+translation_cache::translation_cache(const string& directory, size_t max_bytes) :
+	directory(directory), max_bytes(max_bytes), hits(0), misses(0), stores(0), evictions(0) {}
+
+bool translation_cache::open(string& error) {
+	if (mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST) {
+		error = "cannot create cache directory " + directory + ": " + strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+string translation_cache::entry_path(const string& key) {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.mips", (unsigned long long) hash_text(key));
+	return directory + "/" + name;
+}
+
+// an entry is the magic line, a line with the sizes and slot counts, then
+// the key and the text
+bool translation_cache::lookup(const string& key, string& text, size_t& slots, size_t& filled) {
+	string path = entry_path(key);
+	ifstream entry(path, ios::binary);
+	string magic;
+	size_t key_size, text_size;
+	if (!entry || !getline(entry, magic) || magic != ENTRY_MAGIC
+			|| !(entry >> key_size >> text_size >> slots >> filled) || entry.get() != '\n'
+			|| key_size != key.size()) {
+		misses++;
+		return false;
+	}
+
+	string stored_key(key_size, '\0');
+	text.resize(text_size);
+	if (!entry.read(&stored_key[0], key_size) || stored_key != key
+			|| (text_size > 0 && !entry.read(&text[0], text_size))) {
+		misses++;
+		return false;
+	}
+
+	utime(path.c_str(), NULL); // most recently used now
+	hits++;
+	return true;
+}
+
+void translation_cache::store(const string& key, const string& text, size_t slots, size_t filled) {
+	string path = entry_path(key);
+	ostringstream temp_name;
+	// thread ids repeat across processes that share the directory
+	temp_name << path << ".tmp." << getpid() << '.' << this_thread::get_id();
+	string temp_path = temp_name.str();
+	{
+		ofstream entry(temp_path, ios::binary);
+		entry << ENTRY_MAGIC << '\n' << key.size() << ' ' << text.size() << ' ' << slots << ' ' << filled << '\n';
+		entry.write(key.data(), key.size());
+		entry.write(text.data(), text.size());
+		if (!entry) {
+			entry.close();
+			remove(temp_path.c_str());
+			return;
+		}
+	}
+	if (rename(temp_path.c_str(), path.c_str()) != 0) {
+		remove(temp_path.c_str());
+		return;
+	}
+	stores++;
+}
+
+void translation_cache::evict() {
+	struct entry_info {
+		string path;
+		time_t used;
+		size_t size;
+	};
+	vector<entry_info> entries;
+	size_t total = 0;
+
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL) {
+		return;
+	}
+	for (struct dirent* file = readdir(dir); file != NULL; file = readdir(dir)) {
+		string name = file->d_name;
+		if (name.size() < 5 || name.compare(name.size() - 5, 5, ".mips") != 0) {
+			continue;
+		}
+		struct stat st;
+		string path = directory + "/" + name;
+		if (stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+			entries.push_back({path, st.st_mtime, (size_t) st.st_size});
+			total += st.st_size;
+		}
+	}
+	closedir(dir);
+
+	sort(entries.begin(), entries.end(), [](const entry_info& a, const entry_info& b) {
+		return a.used < b.used;
+	});
+	for (auto entry = entries.begin(); entry != entries.end() && total > max_bytes; entry++) {
+		if (remove(entry->path.c_str()) == 0) {
+			total -= entry->size;
+			evictions++;
+		}
+	}
+}
+
+void translation_cache::report(ostream& os) {
+	size_t lookups = hits + misses;
+	os << "cache: " << hits << " hits, " << misses << " misses";
+	if (lookups > 0) {
+		os << " (" << (100 * hits / lookups) << "% hit rate)";
+	}
+	os << ", " << stores << " stored, " << evictions << " evicted" << endl;
+}
@@ -0,0 +1,48 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <ostream>
+
+using namespace std;
+
+// translated procedures kept on disk across runs, one file per entry named
+// after a hash of its key. The key is the procedure's whole input (with the
+// translator options), and is stored in the entry and compared on lookup,
+// so a hash collision is a miss and never splices in the wrong text.
+// Entries are written to a temporary file and renamed into place, so
+// threads and processes can share a directory. Lookups touch the entry,
+// and evict removes the least recently used entries over the size limit
+class translation_cache {
+private:
+	string directory;
+	size_t max_bytes;
+
+	atomic<size_t> hits;
+	atomic<size_t> misses;
+	atomic<size_t> stores;
+	atomic<size_t> evictions;
+
+	string entry_path(const string& key);
+
+public:
+	translation_cache(const string& directory, size_t max_bytes);
+
+	// creates the directory if needed
+	bool open(string& error);
+
+	// the cached text and delay slot counts for key, false on a miss
+	bool lookup(const string& key, string& text, size_t& slots, size_t& filled);
+	void store(const string& key, const string& text, size_t slots, size_t filled);
+
+	// least recently used entries are removed until the cache fits max_bytes
+	void evict();
+
+	void report(ostream& os);
+};
+
+uint64_t hash_text(const string& text);
+
+#endif
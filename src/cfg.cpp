@@ -0,0 +1,116 @@
+#include "cfg.h"
+
+bool is_conditional_jump(opcode_id opcode) {
+	switch (opcode) {
+		case OP_JE: case OP_JNE: case OP_JL: case OP_JLE: case OP_JG: case OP_JGE:
+			return true;
+		default:
+			return false;
+	}
+}
+
+control_flow_graph::control_flow_graph(const program& prog, const unordered_map<string, int>& label_dic) :
+		exits(prog.block_count(), false), jump_targets(prog.instruction_count(), -1) {
+	size_t block_count = prog.block_count();
+	vector<uint32_t> edge_from, edge_to;
+
+	for (uint32_t b = 0; b < block_count; b++) {
+		bool falls_through = true;
+		for (uint32_t i = prog.get_block_first(b); i < prog.get_block_last(b) && falls_through; i++) {
+			opcode_id op = prog.get_opcode(i);
+			if (op == OP_JMP || is_conditional_jump(op)) {
+				auto target = label_dic.find(prog.get_operand(i, 0).text.str());
+				if (target != label_dic.end()) {
+					jump_targets[i] = target->second;
+					edge_from.push_back(b);
+					edge_to.push_back(target->second);
+				} else {
+					exits[b] = true;
+				}
+				falls_through = op != OP_JMP;
+			} else if (op == OP_LEAVE || op == OP_RET) {
+				exits[b] = true;
+				falls_through = false;
+			}
+		}
+		if (falls_through) {
+			if (b + 1 < block_count) {
+				edge_from.push_back(b);
+				edge_to.push_back(b + 1);
+			} else {
+				exits[b] = true;
+			}
+		}
+	}
+
+	// edges grouped by block, counting sort in both directions
+	successor_first.assign(block_count + 1, 0);
+	predecessor_first.assign(block_count + 1, 0);
+	for (size_t e = 0; e < edge_from.size(); e++) {
+		successor_first[edge_from[e] + 1]++;
+		predecessor_first[edge_to[e] + 1]++;
+	}
+	for (size_t b = 0; b < block_count; b++) {
+		successor_first[b + 1] += successor_first[b];
+		predecessor_first[b + 1] += predecessor_first[b];
+	}
+	successors.resize(edge_from.size());
+	predecessors.resize(edge_from.size());
+	vector<uint32_t> successor_fill(successor_first.begin(), successor_first.end() - 1);
+	vector<uint32_t> predecessor_fill(predecessor_first.begin(), predecessor_first.end() - 1);
+	for (size_t e = 0; e < edge_from.size(); e++) {
+		successors[successor_fill[edge_from[e]]++] = edge_to[e];
+		predecessors[predecessor_fill[edge_to[e]]++] = edge_from[e];
+	}
+}
+
+size_t control_flow_graph::block_count() const {
+	return exits.size();
+}
+
+block_list control_flow_graph::get_successors(uint32_t b) const {
+	return block_list{successors.data() + successor_first[b], successors.data() + successor_first[b + 1]};
+}
+
+block_list control_flow_graph::get_predecessors(uint32_t b) const {
+	return block_list{predecessors.data() + predecessor_first[b], predecessors.data() + predecessor_first[b + 1]};
+}
+
+bool control_flow_graph::is_exit(uint32_t b) const {
+	return exits[b];
+}
+
+int32_t control_flow_graph::get_jump_target(uint32_t i) const {
+	return jump_targets[i];
+}
+
+vector<uint32_t> control_flow_graph::postorder() const {
+	vector<uint32_t> order;
+	order.reserve(block_count());
+	vector<bool> visited(block_count(), false);
+	// explicit stack of (block, next successor to visit), procedures can be deep
+	vector<pair<uint32_t, uint32_t>> stack;
+
+	for (uint32_t root = 0; root < block_count(); root++) {
+		if (visited[root]) {
+			continue;
+		}
+		visited[root] = true;
+		stack.push_back(make_pair(root, 0));
+		while (!stack.empty()) {
+			uint32_t b = stack.back().first;
+			block_list next = get_successors(b);
+			if (stack.back().second < next.size()) {
+				uint32_t s = next.first[stack.back().second++];
+				if (!visited[s]) {
+					visited[s] = true;
+					stack.push_back(make_pair(s, 0));
+				}
+			} else {
+				order.push_back(b);
+				stack.pop_back();
+			}
+		}
+	}
+	return order;
+}
@@ -0,0 +1,55 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "program.h"
+
+using namespace std;
+
+// the blocks a block can continue in, a view into the graph's edge array
+struct block_list {
+	const uint32_t* first;
+	const uint32_t* last;
+
+	const uint32_t* begin() const { return first; }
+	const uint32_t* end() const { return last; }
+	size_t size() const { return last - first; }
+};
+
+// control flow between the blocks of a program: fall-through, jmp and
+// conditional jump edges. Calls are assumed to return. A block exits when
+// it returns, jumps to a label the program does not define, or falls off
+// the end of the program
+class control_flow_graph {
+private:
+	// the successors of block b are successors[successor_first[b]] up to
+	// successors[successor_first[b + 1]], likewise the predecessors
+	vector<uint32_t> successor_first;
+	vector<uint32_t> successors;
+	vector<uint32_t> predecessor_first;
+	vector<uint32_t> predecessors;
+	vector<bool> exits;
+	vector<int32_t> jump_targets; // per instruction, -1 if it does not jump to a known block
+
+public:
+	control_flow_graph(const program& prog, const unordered_map<string, int>& label_dic);
+
+	size_t block_count() const;
+	block_list get_successors(uint32_t b) const;
+	block_list get_predecessors(uint32_t b) const;
+	bool is_exit(uint32_t b) const;
+	// the block jmp or jcc instruction i jumps to, -1 for any other
+	// instruction or an undefined label
+	int32_t get_jump_target(uint32_t i) const;
+
+	// blocks in postorder of a depth-first walk from block 0, then from each
+	// block not reached yet; a backward dataflow converges fastest this way
+	vector<uint32_t> postorder() const;
+};
+
+bool is_conditional_jump(opcode_id opcode);
+
+#endif
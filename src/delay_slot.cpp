@@ -0,0 +1,293 @@
+#include "delay_slot.h"
+#include "strength.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+static const char* const REGISTER_NAMES[32] = {
+	"$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3",
+	"$t0", "$t1", "$t2", "$t3", "$t4", "$t5", "$t6", "$t7",
+	"$s0", "$s1", "$s2", "$s3", "$s4", "$s5", "$s6", "$s7",
+	"$t8", "$t9", "$k0", "$k1", "$gp", "$sp", "$fp", "$ra"
+};
+static const int REG_RA = 31;
+static const int REG_HI = 32;
+static const int REG_LO = 33;
+
+// registers an instruction reads and writes, as bit sets over the 32
+// registers plus hi and lo
+struct instruction_effects {
+	uint64_t reads;
+	uint64_t writes;
+	bool loads;
+	bool stores;
+	bool branch;  // has a delay slot
+	bool barrier; // nothing may move across it, e.g. syscall
+	bool single;  // assembles to exactly one machine instruction
+
+	instruction_effects() : reads(0), writes(0), loads(false), stores(false),
+		branch(false), barrier(false), single(true) {}
+};
+
+static int register_number(text_ref name) {
+	for (int r = 0; r < 32; r++) {
+		if (name == REGISTER_NAMES[r]) {
+			return r;
+		}
+	}
+	return -1;
+}
+
+static uint64_t bit(int r) {
+	return r < 0 ? 0 : (uint64_t) 1 << r;
+}
+
+static bool fits_immediate(text_ref text) {
+	if (!is_number(text)) {
+		return false;
+	}
+	long value = strtol(text.str().c_str(), NULL, 0);
+	return value >= -32768 && value <= 32767;
+}
+
+// a register or a 16 bit immediate is read, anything else (a symbol or a
+// large constant) makes the assembler expand the instruction
+static void read_operand(const mips_operand& operand, instruction_effects& effects) {
+	switch (operand.kind) {
+		case mips_operand::TEXT: {
+			int r = register_number(operand.text);
+			if (r >= 0) {
+				effects.reads |= bit(r);
+			} else if (operand.negate || !fits_immediate(operand.text)) {
+				effects.single = false;
+			}
+			break;
+		}
+		case mips_operand::NUMBER:
+			effects.single &= operand.number >= -32768 && operand.number <= 32767;
+			break;
+		default:
+			effects.single = false;
+			break;
+	}
+}
+
+static void write_operand(const mips_operand& operand, instruction_effects& effects) {
+	int r = operand.kind == mips_operand::TEXT ? register_number(operand.text) : -1;
+	if (r < 0) {
+		effects.barrier = true;
+	}
+	effects.writes |= bit(r);
+}
+
+// offset(base) in any of its three forms
+static void address_operand(const mips_operand& operand, instruction_effects& effects) {
+	text_ref offset, base;
+	if (operand.kind == mips_operand::TEXT) {
+		const char* open = (const char*) memchr(operand.text.data(), '(', operand.text.size());
+		if (open == NULL || operand.text[operand.text.size() - 1] != ')') {
+			effects.barrier = true;
+			return;
+		}
+		offset = text_ref(operand.text.begin(), open);
+		base = text_ref(open + 1, operand.text.end() - 1);
+	} else if (operand.kind == mips_operand::MEMORY) {
+		offset = operand.text;
+		base = operand.reg;
+	} else if (operand.kind == mips_operand::NUMBER_MEMORY) {
+		effects.single &= operand.number >= -32768 && operand.number <= 32767;
+		base = operand.reg;
+	} else {
+		effects.barrier = true;
+		return;
+	}
+	if (!offset.empty() && !fits_immediate(offset)) {
+		effects.single = false;
+	}
+	int r = register_number(base);
+	if (r < 0) {
+		effects.barrier = true;
+	}
+	effects.reads |= bit(r);
+}
+
+static bool is_one_of(text_ref op, const char* const* names) {
+	for (; *names != NULL; names++) {
+		if (op == *names) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char* const ALU_OPS[] = {
+	"add", "addu", "sub", "subu", "and", "or", "xor", "nor", "slt", "sltu", "sllv", "srlv", "srav",
+	"addi", "addiu", "andi", "ori", "xori", "slti", "sll", "srl", "sra", "not", NULL
+};
+static const char* const CONDITIONAL_BRANCHES[] = {"beq", "bne", "blt", "ble", "bgt", "bge", NULL};
+
+static instruction_effects effects_of(const mips_instruction& instr) {
+	instruction_effects effects;
+	const mips_operand* operands = instr.operands;
+	int count = instr.operand_count;
+	text_ref op = instr.op;
+
+	if (is_one_of(op, ALU_OPS) && count >= 2) {
+		write_operand(operands[0], effects);
+		for (int i = 1; i < count; i++) {
+			read_operand(operands[i], effects);
+		}
+	} else if (is_one_of(op, CONDITIONAL_BRANCHES) && count == 3) {
+		read_operand(operands[0], effects);
+		read_operand(operands[1], effects);
+		effects.branch = true;
+	} else if ((op == "b" || op == "j") && count == 1) {
+		effects.branch = true;
+	} else if (op == "jal" && count == 1) {
+		effects.writes |= bit(REG_RA);
+		effects.branch = true;
+	} else if (op == "jalr" && count >= 1) {
+		if (count == 2) {
+			write_operand(operands[0], effects);
+		} else {
+			effects.writes |= bit(REG_RA);
+		}
+		read_operand(operands[count - 1], effects);
+		effects.branch = true;
+	} else if (op == "jr" && count == 1) {
+		read_operand(operands[0], effects);
+		effects.branch = true;
+	} else if ((op == "mult" || op == "multu") && count == 2) {
+		read_operand(operands[0], effects);
+		read_operand(operands[1], effects);
+		effects.writes |= bit(REG_HI) | bit(REG_LO);
+	} else if ((op == "mflo" || op == "mfhi") && count == 1) {
+		write_operand(operands[0], effects);
+		effects.reads |= bit(op == "mflo" ? REG_LO : REG_HI);
+	} else if (op == "lw" && count == 2) {
+		write_operand(operands[0], effects);
+		address_operand(operands[1], effects);
+		effects.loads = true;
+	} else if (op == "sw" && count == 2) {
+		read_operand(operands[0], effects);
+		address_operand(operands[1], effects);
+		effects.stores = true;
+	} else if (op == "li" && count == 2) {
+		write_operand(operands[0], effects);
+		read_operand(operands[1], effects);
+	} else if (op == "la" && count == 2) {
+		write_operand(operands[0], effects);
+		effects.single = false;
+	} else if (op == "nop" && count == 0) {
+		// nothing
+	} else { // syscall, div and anything unknown stay where they are
+		effects.barrier = true;
+	}
+	return effects;
+}
+
+// whether an instruction can move below all of the instructions summed up in later
+static bool independent(const instruction_effects& moved, const instruction_effects& later) {
+	if (moved.writes & (later.reads | later.writes)) {
+		return false;
+	}
+	if (moved.reads & later.writes) {
+		return false;
+	}
+	if (moved.stores && (later.loads || later.stores)) {
+		return false;
+	}
+	return !(moved.loads && later.stores);
+}
+
+static mips_instruction make_nop(int tab_num) {
+	mips_instruction nop;
+	nop.kind = mips_instruction::INSTRUCTION;
+	nop.tab_num = tab_num;
+	nop.op = "nop";
+	nop.operand_count = 0;
+	return nop;
+}
+
+size_t delay_slot_scheduler::schedule(vector<mips_instruction>& code, size_t& filled) const {
+	vector<mips_instruction> result;
+	result.reserve(code.size() + code.size() / 4);
+	size_t slots = 0;
+	filled = 0;
+	size_t floor = 0; // nothing before this index may move, it is a delay slot or follows a barrier
+
+	for (auto iter = code.begin(); iter != code.end(); iter++) {
+		result.push_back(*iter);
+		if (iter->kind != mips_instruction::INSTRUCTION) {
+			continue;
+		}
+		instruction_effects effects = effects_of(*iter);
+		if (effects.barrier) {
+			floor = result.size();
+			continue;
+		}
+		if (!effects.branch) {
+			continue;
+		}
+
+		slots++;
+		size_t branch = result.size() - 1;
+		instruction_effects between = effects; // the branch and what the candidate would pass
+		bool moved = false;
+		size_t searched = 0;
+		for (size_t j = branch; j > floor && searched < SEARCH_WINDOW; j--) {
+			const mips_instruction& candidate = result[j - 1];
+			if (candidate.kind != mips_instruction::INSTRUCTION) {
+				continue;
+			}
+			searched++;
+			instruction_effects candidate_effects = effects_of(candidate);
+			if (candidate_effects.branch || candidate_effects.barrier) {
+				break;
+			}
+			if (candidate_effects.single && independent(candidate_effects, between)) {
+				mips_instruction slot = candidate;
+				result.erase(result.begin() + (j - 1));
+				result.push_back(slot);
+				moved = true;
+				break;
+			}
+			between.reads |= candidate_effects.reads;
+			between.writes |= candidate_effects.writes;
+			between.loads |= candidate_effects.loads;
+			between.stores |= candidate_effects.stores;
+		}
+		if (moved) {
+			filled++;
+		} else {
+			result.push_back(make_nop(iter->tab_num));
+		}
+		floor = result.size();
+	}
+
+	code.swap(result);
+	return slots;
+}
+
+void delay_slot_scheduler::record(text_ref procedure, size_t slots, size_t filled) {
+	lock_guard<mutex> guard(records_lock);
+	records.push_back({procedure.str(), slots, filled});
+}
+
+static void report_line(ostream& os, const string& name, size_t slots, size_t filled) {
+	os << "delay slots " << name << ": " << filled << "/" << slots << " filled";
+	if (slots > 0) {
+		os << " (" << (100 * filled / slots) << "%)";
+	}
+	os << endl;
+}
+
+void delay_slot_scheduler::report(ostream& os) {
+	lock_guard<mutex> guard(records_lock);
+	size_t slots = 0, filled = 0;
+	for (auto record = records.begin(); record != records.end(); record++) {
+		report_line(os, record->name, record->slots, record->filled);
+		slots += record->slots;
+		filled += record->filled;
+	}
+	report_line(os, "total", slots, filled);
+}
@@ -0,0 +1,43 @@
+#ifndef DELAY_SLOT_H
+#define DELAY_SLOT_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <ostream>
+#include "emitter.h"
+
+using namespace std;
+
+// fills the delay slot after every branch and jump for .set noreorder
+// output: an independent instruction from before the branch is moved into
+// the slot, or a nop is put there. Like the peephole optimizer it runs over
+// the instructions an emitter holds back between two labels, and one
+// instance serves the emitters of all threads
+class delay_slot_scheduler {
+private:
+	// how far back from a branch an instruction for its slot is looked for
+	static const size_t SEARCH_WINDOW = 4;
+
+	struct procedure_slots {
+		string name;
+		size_t slots;
+		size_t filled;
+	};
+
+	mutex records_lock;
+	vector<procedure_slots> records;
+
+public:
+	// returns the number of delay slots in code, and in filled how many of
+	// them got an instruction other than nop
+	size_t schedule(vector<mips_instruction>& code, size_t& filled) const;
+
+	// the slots of one translated procedure, for report
+	void record(text_ref procedure, size_t slots, size_t filled);
+
+	// fill rate of each recorded procedure and overall
+	void report(ostream& os);
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include "emitter.h"
+#include "peephole.h"
+#include "delay_slot.h"
+#include <chrono>
+
+mips_operand mips_operand::num(int number) {
+	mips_operand operand("");
+	operand.kind = NUMBER;
+	operand.number = number;
+	return operand;
+}
+
+mips_operand mips_operand::memory(text_ref offset, text_ref reg) {
+	mips_operand operand(offset);
+	operand.kind = MEMORY;
+	operand.reg = reg;
+	return operand;
+}
+
+mips_operand mips_operand::memory(int offset, text_ref reg) {
+	mips_operand operand("");
+	operand.kind = NUMBER_MEMORY;
+	operand.number = offset;
+	operand.reg = reg;
+	return operand;
+}
+
+mips_operand mips_operand::negated(text_ref text) {
+	mips_operand operand(text);
+	operand.negate = true;
+	return operand;
+}
+
+bool mips_operand::is(const char* text) const {
+	return kind == TEXT && !negate && this->text == text;
+}
+
+bool mips_instruction::is(const char* op_name) const {
+	return kind == INSTRUCTION && op == op_name;
+}
+
+emitter::emitter(ostream& os) : os(os), buffer(BUFFER_SIZE), used(0), written(0),
+	optimizer(NULL), scheduler(NULL), delay_slots(0), filled_slots(0),
+	instruction_count(0), write_seconds(0) {}
+
+void emitter::set_optimizer(peephole* optimizer) {
+	drain();
+	this->optimizer = optimizer;
+}
+
+void emitter::set_scheduler(delay_slot_scheduler* scheduler) {
+	drain();
+	this->scheduler = scheduler;
+}
+
+void emitter::reserve(size_t len) {
+	if (used + len > buffer.size()) {
+		write_buffer();
+	}
+}
+
+void emitter::append(text_ref text) {
+	drain();
+	write(text);
+}
+
+void emitter::write(text_ref text) {
+	if (text.size() > buffer.size()) { // too long to buffer, write through
+		write_buffer();
+		write_through(text.data(), text.size());
+		return;
+	}
+	reserve(text.size());
+	memcpy(&buffer[used], text.data(), text.size());
+	used += text.size();
+}
+
+void emitter::write_through(const char* data, size_t len) {
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	os.write(data, len);
+	written += len;
+	write_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void emitter::append(const char* text) {
+	append(text_ref(text, strlen(text)));
+}
+
+void emitter::append(char c) {
+	drain();
+	write(c);
+}
+
+void emitter::write(char c) {
+	reserve(1);
+	buffer[used++] = c;
+}
+
+void emitter::append_number(int number) {
+	drain();
+	write_number(number);
+}
+
+void emitter::write_number(int number) {
+	char digits[12];
+	int len = 0;
+	unsigned int magnitude = number < 0 ? 0u - (unsigned int) number : (unsigned int) number;
+	do {
+		digits[len++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	} while (magnitude != 0);
+
+	reserve(len + 1);
+	if (number < 0) {
+		buffer[used++] = '-';
+	}
+	while (len > 0) {
+		buffer[used++] = digits[--len];
+	}
+}
+
+void emitter::write_operand(const mips_operand& operand) {
+	switch (operand.kind) {
+		case mips_operand::TEXT:
+			if (operand.negate) {
+				write('-');
+			}
+			write(operand.text);
+			break;
+		case mips_operand::NUMBER:
+			write_number(operand.number);
+			break;
+		case mips_operand::MEMORY:
+			write(operand.text);
+			write('(');
+			write(operand.reg);
+			write(')');
+			break;
+		case mips_operand::NUMBER_MEMORY:
+			write_number(operand.number);
+			write('(');
+			write(operand.reg);
+			write(')');
+			break;
+	}
+}
+
+void emitter::write_instruction(const mips_instruction& instr) {
+	if (instr.kind == mips_instruction::BLANK_LINE) {
+		write('\n');
+		return;
+	}
+	for (int i = 0; i < instr.tab_num; i++) {
+		write('\t');
+	}
+	write(instr.op);
+
+	for (int i = 0; i < instr.operand_count; i++) {
+		write(i == 0 ? text_ref(" ", 1) : text_ref(", ", 2));
+		write_operand(instr.operands[i]);
+	}
+	write('\n');
+}
+
+void emitter::push_instruction(const mips_instruction& instr) {
+	if (optimizer == NULL && scheduler == NULL) {
+		write_instruction(instr);
+		return;
+	}
+	pending.push_back(instr);
+	if (pending.size() >= MAX_PENDING) {
+		drain();
+	}
+}
+
+// hands the held back instructions to the optimizer and the scheduler, and
+// formats what comes out
+void emitter::drain() {
+	if (pending.empty()) {
+		return;
+	}
+	if (optimizer != NULL) {
+		optimizer->optimize(pending);
+	}
+	if (scheduler != NULL) {
+		size_t filled;
+		delay_slots += scheduler->schedule(pending, filled);
+		filled_slots += filled;
+	}
+	for (auto iter = pending.begin(); iter != pending.end(); iter++) {
+		write_instruction(*iter);
+	}
+	pending.clear(); // keeps the capacity
+}
+
+void emitter::emit(int tab_num, text_ref op, initializer_list<mips_operand> operands) {
+	mips_instruction instr;
+	instr.kind = mips_instruction::INSTRUCTION;
+	instr.tab_num = tab_num;
+	instr.op = op;
+	instruction_count++;
+	instr.operand_count = 0;
+	for (auto iter = operands.begin(); iter != operands.end() && instr.operand_count < 3; iter++) {
+		instr.operands[instr.operand_count++] = *iter;
+	}
+	push_instruction(instr);
+}
+
+void emitter::blank_line() {
+	mips_instruction instr;
+	instr.kind = mips_instruction::BLANK_LINE;
+	instr.tab_num = 0;
+	instr.operand_count = 0;
+	push_instruction(instr);
+}
+
+size_t emitter::get_position() {
+	drain();
+	return written + used;
+}
+
+size_t emitter::get_delay_slots() {
+	drain();
+	return delay_slots;
+}
+
+size_t emitter::get_filled_slots() {
+	drain();
+	return filled_slots;
+}
+
+void emitter::write_buffer() {
+	if (used > 0) {
+		write_through(&buffer[0], used);
+		used = 0;
+	}
+}
+
+void emitter::flush() {
+	drain();
+	write_buffer();
+}
+
+emitter::~emitter() {
+	flush();
+}
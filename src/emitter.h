@@ -0,0 +1,120 @@
+#ifndef EMITTER_H
+#define EMITTER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <initializer_list>
+#include "text_ref.h"
+
+using namespace std;
+
+// one operand of an emitted MIPS instruction. Text parts are views, so they
+// must point at storage that outlives the translation (register names, the
+// parsed input, string literals)
+struct mips_operand {
+	enum kind_t { TEXT, NUMBER, MEMORY, NUMBER_MEMORY };
+
+	kind_t kind;
+	text_ref text;  // TEXT, or the offset of MEMORY
+	text_ref reg;   // base register of MEMORY and NUMBER_MEMORY
+	int number;     // NUMBER, or the offset of NUMBER_MEMORY
+	bool negate;    // TEXT printed with a leading '-'
+
+	mips_operand() : kind(TEXT), number(0), negate(false) {}
+	mips_operand(const char* text) : kind(TEXT), text(text, strlen(text)), number(0), negate(false) {}
+	mips_operand(const string& text) : kind(TEXT), text(text), number(0), negate(false) {}
+	mips_operand(string&& text) = delete; // would dangle
+	mips_operand(text_ref text) : kind(TEXT), text(text), number(0), negate(false) {}
+
+	static mips_operand num(int number);
+	static mips_operand memory(text_ref offset, text_ref reg);
+	static mips_operand memory(int offset, text_ref reg);
+	static mips_operand negated(text_ref text);
+
+	// a plain TEXT operand spelled exactly as text
+	bool is(const char* text) const;
+};
+
+// one emitted line: an instruction, or the blank line that separates a
+// compare-and-branch from what follows
+struct mips_instruction {
+	enum kind_t { INSTRUCTION, BLANK_LINE };
+
+	kind_t kind;
+	int tab_num;
+	text_ref op;
+	mips_operand operands[3];
+	int operand_count;
+
+	bool is(const char* op_name) const;
+};
+
+class peephole;
+class delay_slot_scheduler;
+
+// formats MIPS assembly straight into a fixed size buffer and writes it to
+// the output stream whenever the buffer fills up. With a peephole optimizer
+// or a delay slot scheduler, instructions are held back until the next label,
+// directive or other raw text, and are rewritten before they are formatted
+class emitter {
+private:
+	static const size_t BUFFER_SIZE = 64 * 1024;
+	static const size_t MAX_PENDING = 4096;
+
+	ostream& os;
+	vector<char> buffer;
+	size_t used;
+	size_t written;
+
+	peephole* optimizer;
+	delay_slot_scheduler* scheduler;
+	vector<mips_instruction> pending;
+	size_t delay_slots;
+	size_t filled_slots;
+	size_t instruction_count;
+	double write_seconds;
+
+	void reserve(size_t len);
+	void write_operand(const mips_operand& operand);
+	void write_instruction(const mips_instruction& instr);
+	void push_instruction(const mips_instruction& instr);
+	void drain();
+	// the append methods' formatting, without draining the instructions
+	// held back, for the code that formats them
+	void write(text_ref text);
+	void write(char c);
+	void write_number(int number);
+	void write_through(const char* data, size_t len);
+	void write_buffer();
+
+public:
+	emitter(ostream& os);
+
+	void set_optimizer(peephole* optimizer);
+	void set_scheduler(delay_slot_scheduler* scheduler);
+
+	void append(text_ref text);
+	void append(const char* text);
+	void append(char c);
+	void append_number(int number);
+
+	// tab_num tabs, op, then the operands separated by ", ", then a newline
+	void emit(int tab_num, text_ref op, initializer_list<mips_operand> operands);
+	void blank_line();
+
+	// number of bytes emitted so far
+	size_t get_position();
+	// delay slots scheduled so far, and how many of them hold more than a nop
+	size_t get_delay_slots();
+	size_t get_filled_slots();
+	// instructions emitted so far, before any optimization
+	size_t get_instruction_count() const { return instruction_count; }
+	// time spent writing the buffer to the output stream
+	double get_write_seconds() const { return write_seconds; }
+
+	void flush();
+	~emitter();
+};
+
+#endif
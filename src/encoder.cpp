@@ -0,0 +1,767 @@
+#include "encoder.h"
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <unordered_set>
+#include <stdlib.h>
+#include <ctype.h>
+
+static const char* const REGISTER_NAMES[32] = {
+	"zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+	"t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+	"s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+	"t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+static const int REG_ZERO = 0;
+static const int REG_AT = 1; // the pseudo instructions' scratch register
+static const int REG_RA = 31;
+
+/** instruction formats **/
+
+static uint32_t r_type(uint32_t funct, int rs, int rt, int rd, int shamt = 0, uint32_t opcode = 0) {
+	return opcode << 26 | (uint32_t) rs << 21 | (uint32_t) rt << 16 | (uint32_t) rd << 11 | (uint32_t) (shamt & 31) << 6 | funct;
+}
+
+static uint32_t i_type(uint32_t opcode, int rs, int rt, int32_t immediate) {
+	return opcode << 26 | (uint32_t) rs << 21 | (uint32_t) rt << 16 | ((uint32_t) immediate & 0xffff);
+}
+
+static uint32_t j_type(uint32_t opcode, uint32_t address) {
+	return opcode << 26 | (address >> 2 & 0x3ffffff);
+}
+
+static const uint32_t OP_SPECIAL2 = 0x1c;
+static const uint32_t OP_REGIMM = 0x01;
+static const uint32_t OP_J = 0x02, OP_JAL = 0x03, OP_BEQ = 0x04, OP_BNE = 0x05, OP_BLEZ = 0x06, OP_BGTZ = 0x07;
+static const uint32_t OP_ADDIU = 0x09, OP_SLTI = 0x0a, OP_ORI = 0x0d, OP_LUI = 0x0f;
+static const uint32_t FUNCT_JR = 0x08, FUNCT_JALR = 0x09, FUNCT_SYSCALL = 0x0c;
+static const uint32_t FUNCT_MFHI = 0x10, FUNCT_MFLO = 0x12, FUNCT_DIV = 0x1a;
+static const uint32_t FUNCT_ADD = 0x20, FUNCT_ADDU = 0x21, FUNCT_SUB = 0x22, FUNCT_SUBU = 0x23;
+static const uint32_t FUNCT_OR = 0x25, FUNCT_NOR = 0x27, FUNCT_SLT = 0x2a;
+
+// how an immediate third operand is encoded
+enum immediate_kind {
+	IMM_SIGNED,   // the I-type form when it fits 16 bits signed
+	IMM_UNSIGNED, // the I-type form when it fits 16 bits unsigned
+	IMM_SHIFT,    // the shift amount
+	IMM_NONE      // always built in $at first
+};
+
+// rd, rs, and a register or immediate
+struct alu_form {
+	const char* name;
+	uint32_t opcode;          // of the register form, SPECIAL or SPECIAL2
+	uint32_t funct;
+	uint32_t variable_funct;  // of a shift by a register
+	uint32_t immediate_opcode;
+	immediate_kind kind;
+	bool negate;              // sub rd, rs, n is addi rd, rs, -n
+};
+
+static const alu_form ALU_FORMS[] = {
+	{"add", 0, FUNCT_ADD, 0, 0x08, IMM_SIGNED, false}, {"addi", 0, FUNCT_ADD, 0, 0x08, IMM_SIGNED, false},
+	{"addu", 0, FUNCT_ADDU, 0, OP_ADDIU, IMM_SIGNED, false}, {"addiu", 0, FUNCT_ADDU, 0, OP_ADDIU, IMM_SIGNED, false},
+	{"sub", 0, FUNCT_SUB, 0, 0x08, IMM_SIGNED, true}, {"subu", 0, FUNCT_SUBU, 0, OP_ADDIU, IMM_SIGNED, true},
+	{"and", 0, 0x24, 0, 0x0c, IMM_UNSIGNED, false}, {"andi", 0, 0x24, 0, 0x0c, IMM_UNSIGNED, false},
+	{"or", 0, FUNCT_OR, 0, OP_ORI, IMM_UNSIGNED, false}, {"ori", 0, FUNCT_OR, 0, OP_ORI, IMM_UNSIGNED, false},
+	{"xor", 0, 0x26, 0, 0x0e, IMM_UNSIGNED, false}, {"xori", 0, 0x26, 0, 0x0e, IMM_UNSIGNED, false},
+	{"nor", 0, FUNCT_NOR, 0, 0, IMM_NONE, false},
+	{"slt", 0, FUNCT_SLT, 0, OP_SLTI, IMM_SIGNED, false}, {"slti", 0, FUNCT_SLT, 0, OP_SLTI, IMM_SIGNED, false},
+	{"sltu", 0, 0x2b, 0, 0x0b, IMM_SIGNED, false}, {"sltiu", 0, 0x2b, 0, 0x0b, IMM_SIGNED, false},
+	{"sll", 0, 0x00, 0x04, 0, IMM_SHIFT, false}, {"sllv", 0, 0x00, 0x04, 0, IMM_SHIFT, false},
+	{"srl", 0, 0x02, 0x06, 0, IMM_SHIFT, false}, {"srlv", 0, 0x02, 0x06, 0, IMM_SHIFT, false},
+	{"sra", 0, 0x03, 0x07, 0, IMM_SHIFT, false}, {"srav", 0, 0x03, 0x07, 0, IMM_SHIFT, false},
+	{"mul", OP_SPECIAL2, 0x02, 0, 0, IMM_NONE, false},
+};
+
+struct memory_form {
+	const char* name;
+	uint32_t opcode;
+};
+
+static const memory_form MEMORY_FORMS[] = {
+	{"lw", 0x23}, {"sw", 0x2b}, {"lh", 0x21}, {"lhu", 0x25}, {"sh", 0x29},
+	{"lb", 0x20}, {"lbu", 0x24}, {"sb", 0x28},
+};
+
+template <typename form, size_t count>
+static const form* find_form(const form (&forms)[count], const string& name) {
+	for (size_t f = 0; f < count; f++) {
+		if (name == forms[f].name) {
+			return &forms[f];
+		}
+	}
+	return NULL;
+}
+
+/** text helpers **/
+
+static bool fits_signed16(int64_t value) {
+	return value >= -32768 && value <= 32767;
+}
+
+static bool fits_unsigned16(int64_t value) {
+	return value >= 0 && value <= 65535;
+}
+
+static string trim(const string& text) {
+	size_t begin = text.find_first_not_of(" \t\r");
+	if (begin == string::npos) {
+		return "";
+	}
+	size_t end = text.find_last_not_of(" \t\r");
+	return text.substr(begin, end - begin + 1);
+}
+
+static string line_error(uint32_t line, const string& message) {
+	return "line " + to_string(line) + ": " + message;
+}
+
+static int parse_register(const string& text) {
+	if (text.size() < 2 || text[0] != '$') {
+		return -1;
+	}
+	string name = text.substr(1);
+	if (isdigit((unsigned char) name[0])) {
+		int r = atoi(name.c_str());
+		return r >= 0 && r < 32 ? r : -1;
+	}
+	if (name == "s8") {
+		return 30;
+	}
+	for (int r = 0; r < 32; r++) {
+		if (name == REGISTER_NAMES[r]) {
+			return r;
+		}
+	}
+	return -1;
+}
+
+static bool parse_number(const string& text, int64_t& value) {
+	if (text.empty()) {
+		return false;
+	}
+	const char* begin = text.c_str();
+	if (*begin == '\'' && text.size() == 3 && text[2] == '\'') {
+		value = text[1];
+		return true;
+	}
+	char* end;
+	value = strtoll(begin, &end, 0);
+	return end != begin && *end == '\0';
+}
+
+// the text up to the first comment, # inside quotes is kept
+static string strip_comment(const string& line) {
+	bool quoted = false;
+	for (size_t i = 0; i < line.size(); i++) {
+		if (line[i] == '"' && (i == 0 || line[i - 1] != '\\')) {
+			quoted = !quoted;
+		} else if (line[i] == '#' && !quoted) {
+			return line.substr(0, i);
+		}
+	}
+	return line;
+}
+
+static vector<string> split_operands(const string& text) {
+	vector<string> operands;
+	string current;
+	bool quoted = false;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '"' && (i == 0 || text[i - 1] != '\\')) {
+			quoted = !quoted;
+		}
+		if (text[i] == ',' && !quoted) {
+			operands.push_back(trim(current));
+			current.clear();
+		} else {
+			current += text[i];
+		}
+	}
+	if (!trim(current).empty() || !operands.empty()) {
+		operands.push_back(trim(current));
+	}
+	return operands;
+}
+
+static bool is_label_char(char c) {
+	return isalnum((unsigned char) c) || c == '_' || c == '.' || c == '$';
+}
+
+static bool is_branch_or_jump(const string& op) {
+	static const char* const names[] = {
+		"beq", "bne", "blt", "ble", "bgt", "bge", "beqz", "bnez", "bltz", "blez", "bgtz", "bgez",
+		"b", "j", "jal", "jr", "jalr"
+	};
+	for (size_t n = 0; n < sizeof(names) / sizeof(names[0]); n++) {
+		if (op == names[n]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/** assembly **/
+
+mips_encoder::mips_encoder() : resolving(false) {}
+
+bool mips_encoder::add_symbol(const string& name, bool in_text, uint32_t address, string& error) {
+	if (symbol_index.count(name) > 0) {
+		error = "label " + name + " defined twice";
+		return false;
+	}
+	symbol_index[name] = symbols.size();
+	symbols.push_back({name, address, in_text, false});
+	return true;
+}
+
+bool mips_encoder::assemble(const string& source, string& error) {
+	istringstream lines(source);
+	string line_text;
+	uint32_t line = 0;
+	bool in_data = false, noreorder = false;
+	vector<string> pending_labels; // data labels waiting for the next item
+	unordered_set<string> globals;
+
+	// first pass: the data image, and the text with every label taken as 0,
+	// which gives the same number of words
+	while (getline(lines, line_text)) {
+		line++;
+		string rest = trim(strip_comment(line_text));
+
+		while (true) {
+			size_t end = 0;
+			while (end < rest.size() && is_label_char(rest[end])) {
+				end++;
+			}
+			if (end == 0 || end >= rest.size() || rest[end] != ':') {
+				break;
+			}
+			string label = rest.substr(0, end);
+			if (in_data) {
+				if (symbol_index.count(label) > 0 || find(pending_labels.begin(), pending_labels.end(), label) != pending_labels.end()) {
+					error = line_error(line, "label " + label + " defined twice");
+					return false;
+				}
+				pending_labels.push_back(label);
+			} else if (!add_symbol(label, true, TEXT_BASE + 4 * text.size(), error)) {
+				error = line_error(line, error);
+				return false;
+			}
+			rest = trim(rest.substr(end + 1));
+		}
+		if (rest.empty()) {
+			continue;
+		}
+
+		size_t word_end = rest.find_first_of(" \t");
+		string word = rest.substr(0, word_end);
+		string args = word_end == string::npos ? "" : trim(rest.substr(word_end));
+		if (word[0] == '.') {
+			if (word == ".data" || word == ".text") {
+				for (auto label = pending_labels.begin(); label != pending_labels.end(); label++) {
+					add_symbol(*label, false, DATA_BASE + data.size(), error);
+				}
+				pending_labels.clear();
+				in_data = word == ".data";
+			} else if (word == ".set") {
+				if (args == "noreorder") {
+					noreorder = true;
+				} else if (args == "reorder") {
+					noreorder = false;
+				}
+			} else if (word == ".globl") {
+				globals.insert(args);
+			} else if (word == ".ent" || word == ".end" || word == ".extern") {
+				// nothing to do
+			} else if (!in_data) {
+				error = line_error(line, word + " outside .data");
+				return false;
+			} else if (!parse_data(word, args, pending_labels, error)) {
+				error = line_error(line, error);
+				return false;
+			}
+			continue;
+		}
+		if (in_data) {
+			error = line_error(line, "instruction " + word + " in .data");
+			return false;
+		}
+		statements.push_back({word, split_operands(args), noreorder, line});
+		if (!encode(statements.back(), error)) {
+			error = line_error(line, error);
+			return false;
+		}
+	}
+	for (auto label = pending_labels.begin(); label != pending_labels.end(); label++) {
+		add_symbol(*label, false, DATA_BASE + data.size(), error);
+	}
+	for (auto name = globals.begin(); name != globals.end(); name++) {
+		auto symbol = symbol_index.find(*name);
+		if (symbol != symbol_index.end()) {
+			symbols[symbol->second].global = true;
+		}
+	}
+
+	// second pass: the same words with the labels filled in
+	size_t text_words = text.size();
+	text.clear();
+	resolving = true;
+	for (size_t s = 0; s < statements.size(); s++) {
+		size_t first_word = text.size();
+		if (!encode(statements[s], error)) {
+			error = line_error(statements[s].line, error);
+			return false;
+		}
+		// under noreorder the statement after a branch is its delay slot
+		bool in_delay_slot = s > 0 && statements[s - 1].noreorder && is_branch_or_jump(statements[s - 1].op);
+		if (in_delay_slot && (text.size() - first_word != 1 || is_branch_or_jump(statements[s].op))) {
+			error = line_error(statements[s].line, "the delay slot must hold a single word instruction that is not a branch");
+			return false;
+		}
+	}
+	if (!statements.empty() && statements.back().noreorder && is_branch_or_jump(statements.back().op)) {
+		error = line_error(statements.back().line, "the last branch has no delay slot");
+		return false;
+	}
+	if (text.size() != text_words) {
+		error = "the passes disagree on the size of the text";
+		return false;
+	}
+
+	stable_sort(symbols.begin(), symbols.end(), [](const mips_symbol& a, const mips_symbol& b) {
+		return a.address < b.address;
+	});
+	for (size_t s = 0; s < symbols.size(); s++) {
+		symbol_index[symbols[s].name] = s;
+	}
+	return true;
+}
+
+// .align, .space and the data items, which first bind the labels before them
+bool mips_encoder::parse_data(const string& directive, const string& args, vector<string>& pending_labels, string& error) {
+	size_t alignment = 1;
+	if (directive == ".word") {
+		alignment = 4;
+	} else if (directive == ".half") {
+		alignment = 2;
+	} else if (directive == ".align") {
+		int64_t power;
+		if (!parse_number(args, power) || power < 0 || power > 12) {
+			error = "bad .align";
+			return false;
+		}
+		alignment = (size_t) 1 << power;
+	}
+	data.resize((data.size() + alignment - 1) / alignment * alignment);
+	if (directive == ".align") {
+		return true;
+	}
+	for (auto label = pending_labels.begin(); label != pending_labels.end(); label++) {
+		if (!add_symbol(*label, false, DATA_BASE + data.size(), error)) {
+			return false;
+		}
+	}
+	pending_labels.clear();
+
+	if (directive == ".ascii" || directive == ".asciiz") {
+		if (args.size() < 2 || args[0] != '"' || args.back() != '"') {
+			error = "expected a quoted string";
+			return false;
+		}
+		for (size_t i = 1; i + 1 < args.size(); i++) {
+			char c = args[i];
+			if (c == '\\' && i + 2 < args.size()) {
+				c = args[++i];
+				switch (c) {
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case '0': c = '\0'; break;
+					default: break; // \\ and \"
+				}
+			}
+			data.push_back(c);
+		}
+		if (directive == ".asciiz") {
+			data.push_back('\0');
+		}
+		return true;
+	}
+	if (directive == ".space") {
+		int64_t size;
+		if (!parse_number(args, size) || size < 0) {
+			error = "bad .space";
+			return false;
+		}
+		data.resize(data.size() + size);
+		return true;
+	}
+
+	size_t size = directive == ".word" ? 4 : directive == ".half" ? 2 : directive == ".byte" ? 1 : 0;
+	if (size == 0) {
+		error = "unknown directive " + directive;
+		return false;
+	}
+	vector<string> values = split_operands(args);
+	for (auto value = values.begin(); value != values.end(); value++) {
+		int64_t number;
+		if (!parse_number(*value, number)) {
+			error = "bad value " + *value;
+			return false;
+		}
+		for (size_t i = 0; i < size; i++) {
+			data.push_back((uint8_t) ((uint32_t) number >> (8 * i)));
+		}
+	}
+	return true;
+}
+
+// a label with an optional +/- offset. In the first pass every label is 0
+bool mips_encoder::label_address(const string& operand, int64_t& address, string& error) {
+	size_t sign = operand.find_first_of("+-", 1);
+	string label = trim(operand.substr(0, sign));
+	int64_t offset = 0;
+	if (label.empty() || !is_label_char(label[0]) || isdigit((unsigned char) label[0])
+			|| (sign != string::npos && !parse_number(trim(operand.substr(sign + 1)), offset))) {
+		error = "bad operand " + operand;
+		return false;
+	}
+	if (sign != string::npos && operand[sign] == '-') {
+		offset = -offset;
+	}
+	address = 0;
+	if (!resolving) {
+		return true;
+	}
+	auto symbol = symbol_index.find(label);
+	if (symbol == symbol_index.end()) {
+		error = "unknown label " + label;
+		return false;
+	}
+	address = symbols[symbol->second].address + offset;
+	return true;
+}
+
+// addiu or ori from $zero when the value fits 16 bits, lui and ori otherwise
+void mips_encoder::encode_li(int rd, int64_t value) {
+	if (fits_signed16(value)) {
+		text.push_back(i_type(OP_ADDIU, REG_ZERO, rd, (int32_t) value));
+	} else if (fits_unsigned16(value)) {
+		text.push_back(i_type(OP_ORI, REG_ZERO, rd, (int32_t) value));
+	} else {
+		uint32_t word = (uint32_t) value;
+		text.push_back(i_type(OP_LUI, REG_ZERO, rd, word >> 16));
+		if ((word & 0xffff) != 0) {
+			text.push_back(i_type(OP_ORI, rd, rd, word & 0xffff));
+		}
+	}
+}
+
+// the branch word itself, which is the last word of a pseudo branch
+bool mips_encoder::encode_branch(const statement& s, uint32_t opcode, int rs, int rt, const string& target, string& error) {
+	int64_t address;
+	if (!label_address(target, address, error)) {
+		return false;
+	}
+	int64_t offset = 0;
+	if (resolving) {
+		offset = (address - (TEXT_BASE + 4 * (int64_t) text.size() + 4)) / 4;
+		if (!fits_signed16(offset)) {
+			error = "branch to " + target + " out of range";
+			return false;
+		}
+	}
+	text.push_back(i_type(opcode, rs, rt, (int32_t) offset));
+	if (!s.noreorder) {
+		text.push_back(0);
+	}
+	return true;
+}
+
+bool mips_encoder::encode(const statement& s, string& error) {
+	const string& op = s.op;
+	const vector<string>& operands = s.operands;
+	size_t count = operands.size();
+	auto reg = [&](size_t i, int& r) {
+		r = i < count ? parse_register(operands[i]) : -1;
+		if (r < 0) {
+			error = "expected a register as operand " + to_string(i + 1) + " of " + op;
+			return false;
+		}
+		return true;
+	};
+	auto operand_count = [&](size_t expected) {
+		if (count != expected) {
+			error = op + " takes " + to_string(expected) + " operands";
+			return false;
+		}
+		return true;
+	};
+
+	const alu_form* alu = find_form(ALU_FORMS, op);
+	if (alu != NULL) {
+		int rd, rs, rt;
+		if (!operand_count(3) || !reg(0, rd) || !reg(1, rs)) {
+			return false;
+		}
+		rt = parse_register(operands[2]);
+		if (rt >= 0) {
+			if (alu->kind == IMM_SHIFT) { // the amount is in rs
+				text.push_back(r_type(alu->variable_funct, rt, rs, rd));
+			} else {
+				text.push_back(r_type(alu->funct, rs, rt, rd, 0, alu->opcode));
+			}
+			return true;
+		}
+		int64_t immediate;
+		if (!parse_number(operands[2], immediate)) {
+			error = "bad operand " + operands[2] + " of " + op;
+			return false;
+		}
+		int64_t encoded = alu->negate ? -immediate : immediate;
+		if (alu->kind == IMM_SHIFT) {
+			text.push_back(r_type(alu->funct, 0, rs, rd, (int) immediate));
+		} else if ((alu->kind == IMM_SIGNED && fits_signed16(encoded)) || (alu->kind == IMM_UNSIGNED && fits_unsigned16(encoded))) {
+			text.push_back(i_type(alu->immediate_opcode, rs, rd, (int32_t) encoded));
+		} else {
+			encode_li(REG_AT, immediate);
+			text.push_back(r_type(alu->funct, rs, REG_AT, rd, 0, alu->opcode));
+		}
+		return true;
+	}
+
+	const memory_form* memory = find_form(MEMORY_FORMS, op);
+	if (memory != NULL) {
+		int rt;
+		if (!operand_count(2) || !reg(0, rt)) {
+			return false;
+		}
+		const string& address = operands[1];
+		size_t open = address.find('(');
+		int base = REG_ZERO;
+		string offset_text = address;
+		if (open != string::npos) {
+			base = parse_register(trim(address.substr(open + 1, address.find(')', open) - open - 1)));
+			if (base < 0 || address.back() != ')') {
+				error = "bad address " + address;
+				return false;
+			}
+			offset_text = trim(address.substr(0, open));
+		}
+		int64_t offset = 0;
+		bool is_number = offset_text.empty() || parse_number(offset_text, offset);
+		if (!is_number && !label_address(offset_text, offset, error)) {
+			return false;
+		}
+		if (is_number && open != string::npos && fits_signed16(offset)) {
+			text.push_back(i_type(memory->opcode, base, rt, (int32_t) offset));
+			return true;
+		}
+		// the upper half through $at, adjusted for the sign of the lower half
+		uint32_t word = (uint32_t) offset;
+		text.push_back(i_type(OP_LUI, REG_ZERO, REG_AT, (word + 0x8000) >> 16));
+		if (base != REG_ZERO) {
+			text.push_back(r_type(FUNCT_ADDU, REG_AT, base, REG_AT));
+		}
+		text.push_back(i_type(memory->opcode, REG_AT, rt, (int32_t) (int16_t) (word & 0xffff)));
+		return true;
+	}
+
+	if (op == "li" || op == "lui") {
+		int rd;
+		int64_t immediate;
+		if (!operand_count(2) || !reg(0, rd)) {
+			return false;
+		}
+		if (!parse_number(operands[1], immediate)) {
+			error = op + " takes a register and a number";
+			return false;
+		}
+		if (op == "lui") {
+			text.push_back(i_type(OP_LUI, REG_ZERO, rd, (int32_t) immediate));
+		} else {
+			encode_li(rd, immediate);
+		}
+		return true;
+	}
+	if (op == "la") {
+		int rd;
+		int64_t address;
+		if (!operand_count(2) || !reg(0, rd) || !label_address(operands[1], address, error)) {
+			return false;
+		}
+		text.push_back(i_type(OP_LUI, REG_ZERO, rd, (uint32_t) address >> 16));
+		text.push_back(i_type(OP_ORI, rd, rd, (uint32_t) address & 0xffff));
+		return true;
+	}
+	if (op == "move" || op == "not" || op == "neg" || op == "negu") {
+		int rd, rs;
+		if (!operand_count(2) || !reg(0, rd) || !reg(1, rs)) {
+			return false;
+		}
+		if (op == "move") {
+			text.push_back(r_type(FUNCT_OR, rs, REG_ZERO, rd));
+		} else if (op == "not") {
+			text.push_back(r_type(FUNCT_NOR, rs, REG_ZERO, rd));
+		} else {
+			text.push_back(r_type(op == "neg" ? FUNCT_SUB : FUNCT_SUBU, REG_ZERO, rs, rd));
+		}
+		return true;
+	}
+	if (op == "mult" || op == "multu" || op == "div" || op == "divu") {
+		uint32_t funct = op == "mult" ? 0x18 : op == "multu" ? 0x19 : op == "div" ? FUNCT_DIV : 0x1b;
+		int rd = -1, rs, rt;
+		if (count == 3 && (op == "div" || op == "divu")) { // div rd, rs, rt: div and mflo
+			if (!reg(0, rd) || !reg(1, rs) || !reg(2, rt)) {
+				return false;
+			}
+		} else if (!operand_count(2) || !reg(0, rs) || !reg(1, rt)) {
+			return false;
+		}
+		text.push_back(r_type(funct, rs, rt, 0));
+		if (rd >= 0) {
+			text.push_back(r_type(FUNCT_MFLO, 0, 0, rd));
+		}
+		return true;
+	}
+	if (op == "mflo" || op == "mfhi") {
+		int rd;
+		if (!operand_count(1) || !reg(0, rd)) {
+			return false;
+		}
+		text.push_back(r_type(op == "mflo" ? FUNCT_MFLO : FUNCT_MFHI, 0, 0, rd));
+		return true;
+	}
+
+	/** branches and jumps **/
+	if (op == "beq" || op == "bne" || op == "blt" || op == "ble" || op == "bgt" || op == "bge") {
+		int rs;
+		if (!operand_count(3) || !reg(0, rs)) {
+			return false;
+		}
+		int rt = parse_register(operands[1]);
+		int64_t immediate = 0;
+		if (rt < 0 && !parse_number(operands[1], immediate)) {
+			error = "bad operand " + operands[1] + " of " + op;
+			return false;
+		}
+		if (op == "beq" || op == "bne") {
+			if (rt < 0 && immediate == 0) {
+				rt = REG_ZERO;
+			} else if (rt < 0) {
+				encode_li(REG_AT, immediate);
+				rt = REG_AT;
+			}
+			return encode_branch(s, op == "beq" ? OP_BEQ : OP_BNE, rs, rt, operands[2], error);
+		}
+		// rs < x, and rs > x as x < rs, into $at, then a branch on $at
+		bool less = op == "blt" || op == "bge";
+		bool when_set = op == "blt" || op == "bgt";
+		if (rt >= 0) {
+			text.push_back(less ? r_type(FUNCT_SLT, rs, rt, REG_AT) : r_type(FUNCT_SLT, rt, rs, REG_AT));
+		} else {
+			// rs > n and rs <= n compare with n + 1 when it fits slti
+			int64_t bound = less ? immediate : immediate + 1;
+			if (fits_signed16(bound)) {
+				text.push_back(i_type(OP_SLTI, rs, REG_AT, (int32_t) bound));
+				when_set = op == "blt" || op == "ble";
+			} else {
+				encode_li(REG_AT, immediate);
+				text.push_back(less ? r_type(FUNCT_SLT, rs, REG_AT, REG_AT) : r_type(FUNCT_SLT, REG_AT, rs, REG_AT));
+			}
+		}
+		return encode_branch(s, when_set ? OP_BNE : OP_BEQ, REG_AT, REG_ZERO, operands[2], error);
+	}
+	if (op == "beqz" || op == "bnez" || op == "bltz" || op == "bgez" || op == "blez" || op == "bgtz") {
+		int rs;
+		if (!operand_count(2) || !reg(0, rs)) {
+			return false;
+		}
+		if (op == "beqz" || op == "bnez") {
+			return encode_branch(s, op == "beqz" ? OP_BEQ : OP_BNE, rs, REG_ZERO, operands[1], error);
+		} else if (op == "bltz" || op == "bgez") {
+			return encode_branch(s, OP_REGIMM, rs, op == "bltz" ? 0 : 1, operands[1], error);
+		}
+		return encode_branch(s, op == "blez" ? OP_BLEZ : OP_BGTZ, rs, 0, operands[1], error);
+	}
+	if (op == "b") {
+		if (!operand_count(1)) {
+			return false;
+		}
+		return encode_branch(s, OP_BEQ, REG_ZERO, REG_ZERO, operands[0], error);
+	}
+	if (op == "j" || op == "jal") {
+		int64_t address;
+		if (!operand_count(1) || !label_address(operands[0], address, error)) {
+			return false;
+		}
+		if (resolving && (address < TEXT_BASE || address >= DATA_BASE)) {
+			error = op + " to " + operands[0] + " outside the text";
+			return false;
+		}
+		text.push_back(j_type(op == "j" ? OP_J : OP_JAL, (uint32_t) address));
+	} else if (op == "jr") {
+		int rs;
+		if (!operand_count(1) || !reg(0, rs)) {
+			return false;
+		}
+		text.push_back(r_type(FUNCT_JR, rs, 0, 0));
+	} else if (op == "jalr") {
+		int rd = REG_RA, rs;
+		if (count == 1) {
+			if (!reg(0, rs)) {
+				return false;
+			}
+		} else if (!operand_count(2) || !reg(0, rd) || !reg(1, rs)) {
+			return false;
+		}
+		text.push_back(r_type(FUNCT_JALR, rs, 0, rd));
+	} else if (op == "syscall" || op == "nop") {
+		if (!operand_count(0)) {
+			return false;
+		}
+		text.push_back(op == "syscall" ? FUNCT_SYSCALL : 0);
+		return true;
+	} else {
+		error = "unknown instruction " + op;
+		return false;
+	}
+	if (!s.noreorder) { // the delay slot of the jump
+		text.push_back(0);
+	}
+	return true;
+}
+
+/** output **/
+
+const vector<uint32_t>& mips_encoder::get_text() const {
+	return text;
+}
+
+const vector<uint8_t>& mips_encoder::get_data() const {
+	return data;
+}
+
+const vector<mips_symbol>& mips_encoder::get_symbols() const {
+	return symbols;
+}
+
+void mips_encoder::write_text(ostream& os) const {
+	for (auto word = text.begin(); word != text.end(); word++) {
+		char bytes[4] = {(char) *word, (char) (*word >> 8), (char) (*word >> 16), (char) (*word >> 24)};
+		os.write(bytes, 4);
+	}
+}
+
+void mips_encoder::write_data(ostream& os) const {
+	os.write((const char*) data.data(), data.size());
+}
+
+void mips_encoder::write_symbols(ostream& os) const {
+	for (auto symbol = symbols.begin(); symbol != symbols.end(); symbol++) {
+		char type = symbol->text ? 't' : 'd';
+		os << hex << setw(8) << setfill('0') << symbol->address << dec << ' '
+			<< (char) (symbol->global ? toupper(type) : type) << ' ' << symbol->name << '\n';
+	}
+}
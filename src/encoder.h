@@ -0,0 +1,74 @@
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+using namespace std;
+
+// a label of the assembled program
+struct mips_symbol {
+	string name;
+	uint32_t address;
+	bool text;   // in .text, otherwise in .data
+	bool global; // named by .globl
+};
+
+// assembles the MIPS the translator writes into MIPS32 machine code, so the
+// result can be loaded without an assembler run: a .text image at TEXT_BASE,
+// a .data image at DATA_BASE, both little endian, and a symbol table.
+// Pseudo instructions are expanded here, always to the same number of words
+// for the same operands whatever the labels turn out to be (la is lui and
+// ori, lw of a label lui and lw through $at), so the first pass lays out
+// the labels and the second encodes. Outside .set noreorder a nop follows
+// every branch and jump, where the assembler would put one
+class mips_encoder {
+public:
+	static const uint32_t TEXT_BASE = 0x00400000;
+	static const uint32_t DATA_BASE = 0x10010000;
+
+private:
+	// an instruction of the text segment as written
+	struct statement {
+		string op;
+		vector<string> operands;
+		bool noreorder;
+		uint32_t line;
+	};
+
+	vector<statement> statements;
+	vector<uint32_t> text;
+	vector<uint8_t> data;
+	vector<mips_symbol> symbols;
+	unordered_map<string, size_t> symbol_index;
+	bool resolving; // labels are known, the second pass
+
+	bool add_symbol(const string& name, bool in_text, uint32_t address, string& error);
+	bool parse_data(const string& directive, const string& args, vector<string>& pending_labels, string& error);
+	bool label_address(const string& operand, int64_t& address, string& error);
+	bool encode(const statement& s, string& error);
+	bool encode_branch(const statement& s, uint32_t opcode, int rs, int rt, const string& target, string& error);
+	void encode_li(int rd, int64_t value);
+
+public:
+	mips_encoder();
+
+	// false with the line that failed in error
+	bool assemble(const string& source, string& error);
+
+	const vector<uint32_t>& get_text() const;
+	const vector<uint8_t>& get_data() const;
+	// in address order
+	const vector<mips_symbol>& get_symbols() const;
+
+	void write_text(ostream& os) const;
+	void write_data(ostream& os) const;
+	// one "address type name" line per label in address order, the type as
+	// nm prints it: T or t for text, D or d for data, upper case when global
+	void write_symbols(ostream& os) const;
+};
+
+#endif
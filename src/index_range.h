@@ -0,0 +1,55 @@
+#ifndef INDEX_RANGE_H
+#define INDEX_RANGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class program;
+
+// a view of the handles numbered [first, last) inside a program; T is a
+// handle class (block, instruction) constructible from (program*, index)
+template <class T>
+class index_range {
+public:
+	class iterator {
+	private:
+		const program* prog;
+		uint32_t index;
+
+	public:
+		struct arrow {
+			T value;
+			T* operator->() { return &value; }
+		};
+
+		iterator(const program* prog, uint32_t index) : prog(prog), index(index) {}
+
+		T operator*() const { return T(prog, index); }
+		arrow operator->() const { return arrow{T(prog, index)}; }
+		iterator& operator++() { index++; return *this; }
+		iterator operator++(int) { iterator old = *this; index++; return old; }
+		iterator operator+(int n) const { return iterator(prog, index + n); }
+		int operator-(const iterator& other) const { return (int) index - (int) other.index; }
+		bool operator==(const iterator& other) const { return index == other.index; }
+		bool operator!=(const iterator& other) const { return index != other.index; }
+		uint32_t get_index() const { return index; }
+	};
+
+	index_range() : prog(NULL), first(0), last(0) {}
+	index_range(const program* prog, uint32_t first, uint32_t last) : prog(prog), first(first), last(last) {}
+
+	iterator begin() const { return iterator(prog, first); }
+	iterator end() const { return iterator(prog, last); }
+	size_t size() const { return last - first; }
+	bool empty() const { return first == last; }
+	T operator[](size_t i) const { return T(prog, first + i); }
+	// the handles numbered [from, to) of the same program
+	index_range slice(uint32_t from, uint32_t to) const { return index_range(prog, from, to); }
+
+private:
+	const program* prog;
+	uint32_t first;
+	uint32_t last;
+};
+
+#endif
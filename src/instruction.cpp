@@ -1,44 +1,37 @@
 #include "instruction.h"
+#include "program.h"
 
+instruction::instruction(const program* prog, uint32_t index) :
+	prog(prog), index(index) {}
 
-instruction::instruction(string op, string operand1, string operand2) :
-	op(op), operand1(operand1), operand2(operand2) {}
+const program* instruction::get_program() {
+	return prog;
+}
 
-instruction::instruction(string op, string operand1) :
-	op(op), operand1(operand1), operand2("") {}
+uint32_t instruction::get_index() {
+	return index;
+}
 
-instruction::instruction(string op) : 
-	op(op), operand1(""), operand2("") {}
-	
-string instruction::get_op() {
-	return op;
+opcode_id instruction::get_opcode() {
+	return prog->get_opcode(index);
 }
 
-string instruction::get_operand1() {
-	return operand1;
+operand_desc instruction::get_operand1() {
+	return prog->get_operand(index, 0);
 }
 
-string instruction::get_operand2() {
-	return operand2;
+operand_desc instruction::get_operand2() {
+	return prog->get_operand(index, 1);
 }
 
-string instruction::to_string(int tab_num, string op, initializer_list<string> operands) {
-	string instr_string = "";
-			
-	instr_string.append(tab_num, '\t');
-	instr_string.append(op);
-					
-	if (operands.size() > 0) {
-		instr_string.append(" ");
-		auto iter = operands.begin();
-		instr_string.append(*iter);
-		iter++;
-												
-		for (; iter != operands.end(); iter++) {
-			instr_string.append(", ");
-			instr_string.append(*iter);
-		}
-	}
+bool instruction::is_live_after(register_id reg) {
+	return (prog->get_live_after(index) & register_bit(reg)) != 0;
+}
+
+register_set instruction::get_live_after() {
+	return prog->get_live_after(index);
+}
 
-	return instr_string + "\n";
+address_use instruction::get_address_use() {
+	return prog->get_address_use(index);
 }
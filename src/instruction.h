@@ -1,26 +1,34 @@
 #ifndef INSTRUCTION_H
 #define INSTRUCTION_H
 
-#include <string>
+#include <stdint.h>
+#include "text_ref.h"
+#include "opcode.h"
+#include "operand.h"
 
 using namespace std;
 
+class program;
+struct address_use;
+
+// handle of an instruction stored in a program, cheap to copy
 class instruction {
 private:
-	string op;
-	string operand1;
-	string operand2;
+	const program* prog;
+	uint32_t index;
 
 public:
-	instruction(string op, string operand1, string operand2);
-	instruction(string op, string operand1);
-	instruction(string op);
-
-	string get_op();
-	string get_operand1();
-	string get_operand2();
-
-	static string to_string(int tab_num, string op, initializer_list<string> operands);
+	instruction(const program* prog, uint32_t index);
+
+	const program* get_program();
+	uint32_t get_index();
+	opcode_id get_opcode();
+	operand_desc get_operand1();
+	operand_desc get_operand2();
+	// whether reg may be read before it is written again after this instruction
+	bool is_live_after(register_id reg);
+	register_set get_live_after();
+	address_use get_address_use();
 };
 
 
@@ -0,0 +1,59 @@
+#include "library.h"
+#include <streambuf>
+
+// hands everything written to it to a callback; unbuffered, since the
+// emitter already writes in blocks of up to 64 KB
+class callback_buf : public streambuf {
+private:
+	translation_context::output_callback callback;
+	void* user;
+
+protected:
+	streamsize xsputn(const char* s, streamsize n) {
+		callback(s, n, user);
+		return n;
+	}
+
+	int_type overflow(int_type c) {
+		if (c != traits_type::eof()) {
+			char ch = c;
+			callback(&ch, 1, user);
+		}
+		return traits_type::not_eof(c);
+	}
+
+public:
+	callback_buf(translation_context::output_callback callback, void* user) : callback(callback), user(user) {}
+};
+
+translation_context::translation_context() : input("", 0) {}
+
+translator& translation_context::get_translator() {
+	return engine;
+}
+
+void translation_context::translate(const char* text, size_t size, ostream& os) {
+	input.load(text, size);
+	engine.translate_IA32_to_MIPS(input, os);
+}
+
+void translation_context::translate(const char* text, size_t size, output_callback callback, void* user) {
+	callback_buf buffer(callback, user);
+	ostream os(&buffer);
+	translate(text, size, os);
+}
+
+void translation_context::translate(const string& text, ostream& os) {
+	translate(text.data(), text.size(), os);
+}
+
+void translation_context::translate(const string* lines, size_t count, ostream& os) {
+	input.load(lines, count);
+	engine.translate_IA32_to_MIPS(input, os);
+}
+
+void translation_context::translate(const string* lines, size_t count, output_callback callback, void* user) {
+	callback_buf buffer(callback, user);
+	ostream os(&buffer);
+	translate(lines, count, os);
+}
@@ -0,0 +1,44 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <string>
+#include <ostream>
+#include "translator.h"
+#include "parser.h"
+
+using namespace std;
+
+// the translator for programs that hold their IA32 in memory, as built into
+// libIA32toMISP.a. A context keeps its translator (register names, dispatch
+// table and options) and the memory of its parser from one call to the
+// next, so a call only pays for its own input. Calls on one context must not
+// overlap; use a context per thread
+class translation_context {
+public:
+	// receives the translation in pieces, in order
+	typedef void (*output_callback)(const char* text, size_t size, void* user);
+
+private:
+	translator engine;
+	parser input;
+
+public:
+	translation_context();
+
+	// to set the options (print mode, peephole, scheduler, ...) once for
+	// every call. The entry label, cache and stats apply as in a file run
+	translator& get_translator();
+
+	// each call throws what parser::load throws for input too large for a
+	// program or a scale it cannot hold, see parser.h
+	/** from a buffer **/
+	void translate(const char* text, size_t size, ostream& os);
+	void translate(const char* text, size_t size, output_callback callback, void* user);
+	void translate(const string& text, ostream& os);
+
+	/** from lines without their newlines **/
+	void translate(const string* lines, size_t count, ostream& os);
+	void translate(const string* lines, size_t count, output_callback callback, void* user);
+};
+
+#endif
@@ -0,0 +1,156 @@
+#include "liveness.h"
+#include <deque>
+
+static const register_set IA32_REGISTERS =
+	register_bit(REG_EAX) | register_bit(REG_ECX) | register_bit(REG_EDX) | register_bit(REG_EBX) |
+	register_bit(REG_ESI) | register_bit(REG_EDI) | register_bit(REG_ESP) | register_bit(REG_EBP);
+
+const register_set liveness::EXIT_LIVE = IA32_REGISTERS;
+
+static register_set address_uses(const operand_desc& operand) {
+	switch (operand.kind) {
+		case OPERAND_INDIRECT: return register_bit(operand.base);
+		case OPERAND_INDEXED:
+		case OPERAND_SCALED_INDEXED: return register_bit(operand.base) | register_bit(operand.index);
+		default: return 0;
+	}
+}
+
+static register_set operand_uses(const operand_desc& operand) {
+	return operand.kind == OPERAND_REGISTER ? register_bit(operand.base) : address_uses(operand);
+}
+
+static register_set operand_defs(const operand_desc& operand) {
+	return operand.kind == OPERAND_REGISTER ? register_bit(operand.base) : 0;
+}
+
+// $s6 holds the address of absolute, indexed and scaled indexed operands
+static register_set address_defs(const operand_desc& operand) {
+	bool computed = operand.kind == OPERAND_ABSOLUTE || operand.kind == OPERAND_INDEXED
+		|| (operand.kind == OPERAND_SCALED_INDEXED && !(operand.scale == 1 && operand.base == REG_NONE));
+	return computed ? register_bit(REG_ADDRESSING_RESULT) : 0;
+}
+
+void register_effects(const program& prog, uint32_t i, register_set& uses, register_set& defs) {
+	operand_desc operand1 = prog.get_operand(i, 0);
+	operand_desc operand2 = prog.get_operand(i, 1);
+	register_set temp = register_bit(REG_TEMP);
+	uses = 0;
+	defs = 0;
+
+	switch (prog.get_opcode(i)) {
+		case OP_MOVL:
+			uses = operand_uses(operand1) | address_uses(operand2);
+			defs = operand_defs(operand2) | address_defs(operand1) | address_defs(operand2);
+			if (operand1.kind == OPERAND_IMMEDIATE && operand2.is_memory()) {
+				defs |= temp;
+			}
+			break;
+		case OP_ADDL: case OP_SUBL: case OP_ANDL: case OP_ORL: case OP_XORL:
+		case OP_SALL: case OP_SHLL: case OP_SARL: case OP_SHRL: case OP_IMULL:
+			uses = operand_uses(operand1) | operand_uses(operand2);
+			defs = operand_defs(operand2);
+			if (operand1.is_memory() || operand2.is_memory()) {
+				defs |= temp;
+			}
+			break;
+		case OP_IDIVL:
+			uses = register_bit(REG_EAX) | operand_uses(operand1);
+			defs = register_bit(REG_EAX) | register_bit(REG_EDX);
+			break;
+		case OP_INCL: case OP_DECL: case OP_NEGL: case OP_NOTL:
+			uses = operand_uses(operand1);
+			defs = operand_defs(operand1) | (operand1.is_memory() ? temp : 0);
+			break;
+		case OP_PUSHL:
+			uses = operand_uses(operand1) | register_bit(REG_ESP);
+			defs = register_bit(REG_ESP) | (operand1.kind == OPERAND_IMMEDIATE ? temp : 0);
+			break;
+		case OP_POPL:
+			uses = register_bit(REG_ESP);
+			defs = register_bit(REG_ESP) | operand_defs(operand1);
+			break;
+		case OP_CALL: case OP_LEAVE: case OP_RET:
+			uses = IA32_REGISTERS;
+			break;
+		case OP_CMPL:
+			uses = operand_uses(operand1) | operand_uses(operand2);
+			break;
+		case OP_PRN:
+			uses = operand_uses(operand1);
+			break;
+		case OP_INT:
+			uses = register_bit(REG_ECX);
+			break;
+		default: // jumps; cltd and unknown instructions are not translated
+			break;
+	}
+}
+
+liveness::liveness(const program& prog, const control_flow_graph& cfg) :
+		prog(prog), cfg(cfg), uses(prog.instruction_count()), defs(prog.instruction_count()),
+		live_in(prog.block_count(), 0), live_after(prog.instruction_count(), 0) {
+	for (uint32_t i = 0; i < prog.instruction_count(); i++) {
+		register_effects(prog, i, uses[i], defs[i]);
+	}
+
+	vector<uint32_t> order = cfg.postorder();
+	deque<uint32_t> worklist(order.begin(), order.end());
+	vector<bool> listed(prog.block_count(), true);
+	while (!worklist.empty()) {
+		uint32_t b = worklist.front();
+		worklist.pop_front();
+		listed[b] = false;
+
+		register_set live = transfer(b, false);
+		if (live != live_in[b]) {
+			live_in[b] = live;
+			block_list predecessors = cfg.get_predecessors(b);
+			for (auto p = predecessors.begin(); p != predecessors.end(); p++) {
+				if (!listed[*p]) {
+					listed[*p] = true;
+					worklist.push_back(*p);
+				}
+			}
+		}
+	}
+
+	for (uint32_t b = 0; b < prog.block_count(); b++) {
+		transfer(b, true);
+	}
+}
+
+// walks block b backwards from the live-in sets of its successors; jumps
+// in the middle of a block are followed too
+register_set liveness::transfer(uint32_t b, bool record) {
+	register_set live = b + 1 < prog.block_count() ? live_in[b + 1] : EXIT_LIVE;
+	uint32_t first = prog.get_block_first(b);
+	for (uint32_t i = prog.get_block_last(b); i > first; ) {
+		i--;
+		opcode_id op = prog.get_opcode(i);
+		if (op == OP_JMP || is_conditional_jump(op)) {
+			int32_t target = cfg.get_jump_target(i);
+			register_set target_live = target >= 0 ? live_in[target] : EXIT_LIVE;
+			live = op == OP_JMP ? target_live : (register_set) (live | target_live);
+		} else if (op == OP_LEAVE || op == OP_RET) {
+			live = EXIT_LIVE;
+		}
+		if (record) {
+			live_after[i] = live;
+		}
+		live = (live & ~defs[i]) | uses[i];
+	}
+	return live;
+}
+
+register_set liveness::get_live_in(uint32_t b) const {
+	return live_in[b];
+}
+
+register_set liveness::get_live_after(uint32_t i) const {
+	return live_after[i];
+}
+
+vector<register_set>& liveness::get_live_after() {
+	return live_after;
+}
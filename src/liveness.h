@@ -0,0 +1,42 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <vector>
+#include "program.h"
+#include "cfg.h"
+
+using namespace std;
+
+// the registers the translation of instruction i reads, and those it
+// always writes. Calls and returns read every IA32 register, as the callee
+// or the caller may use any of them
+void register_effects(const program& prog, uint32_t i, register_set& uses, register_set& defs);
+
+// backward bit-vector dataflow: which of the IA32 registers and the
+// scratch registers $s6/$s7 may be read before they are written again.
+// Blocks are solved from a worklist seeded in postorder, so each is
+// revisited only when a successor's live-in set grows
+class liveness {
+private:
+	const program& prog;
+	const control_flow_graph& cfg;
+	vector<register_set> uses;       // per instruction
+	vector<register_set> defs;
+	vector<register_set> live_in;    // per block
+	vector<register_set> live_after; // per instruction
+
+	register_set transfer(uint32_t b, bool record);
+
+public:
+	// live at a return or at a jump out of the program
+	static const register_set EXIT_LIVE;
+
+	liveness(const program& prog, const control_flow_graph& cfg);
+
+	register_set get_live_in(uint32_t b) const;
+	register_set get_live_after(uint32_t i) const;
+	// hands the per instruction sets over, e.g. to program::set_live_after
+	vector<register_set>& get_live_after();
+};
+
+#endif
@@ -1,30 +1,345 @@
 #include <iostream>
 #include <string.h>
-#include <fstream>  
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <chrono>
 #include "parser.h"
 #include "translator.h"
+#include "batch.h"
+#include "server.h"
 
 using namespace std;
 
+static void print_usage() {
+    cout << "Usage: IA32toMISP [options] path_to_input path_to_output" << endl;
+    cout << "       IA32toMISP [options] --batch input output [input output ...]" << endl;
+    cout << "       IA32toMISP [options] --batch-dir input_dir output_dir" << endl;
+    cout << "       IA32toMISP [options] --manifest manifest_file" << endl;
+    cout << "       IA32toMISP [options] --stream [input|- [output|-]]" << endl;
+    cout << "       IA32toMISP [options] --serve socket" << endl;
+    cout << "       IA32toMISP [--binary] --client socket input output [input output ...]" << endl;
+    cout << "       IA32toMISP --client socket --report|--shutdown" << endl;
+    cout << "Options: --mmap --jobs n --peephole[=rule,...] --print=inline|call|auto --noreorder --no-liveness" << endl;
+    cout << "         --cache dir [--cache-size megabytes] --stats[=text|json] --instrument" << endl;
+    cout << "         --reachable[=entry_label] --binary --promote --reuse-addresses" << endl;
+    size_t rule_count;
+    const peephole_rule* rules = peephole::get_rules(rule_count);
+    for (size_t r = 0; r < rule_count; r++) {
+        cout << "  " << rules[r].name << ": " << rules[r].description << endl;
+    }
+}
+
+// the reports of the options given, once the run is over. The cache is
+// trimmed to its size first. The stats text goes to stderr with the others,
+// JSON to stdout for scripts to read
+static void report_run(peephole* optimizer, delay_slot_scheduler* scheduler, translation_cache* cache,
+        translation_stats* stats, bool stats_json) {
+    if (optimizer) {
+        optimizer->report(std::cerr);
+    }
+    if (scheduler) {
+        scheduler->report(std::cerr);
+    }
+    if (cache) {
+        cache->evict();
+        cache->report(std::cerr);
+    }
+    if (stats) {
+        if (stats_json) {
+            stats->report_json(cout);
+        } else {
+            stats->report_text(std::cerr);
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
-    if (argc < 3) {
-        cout << "Usage: IA32toMISP path_to_input path_to_output" << endl;
+    bool use_mmap = false;
+    bool batch = false;
+    bool stream = false;
+    bool binary = false;
+    bool reachable = false;
+    string batch_dir_input, batch_dir_output, manifest_path;
+    string serve_socket, client_socket;
+    bool client_report = false, client_shutdown = false;
+    size_t thread_count = 0;
+    unique_ptr<peephole> optimizer;
+    unique_ptr<delay_slot_scheduler> scheduler;
+    string cache_dir;
+    size_t cache_megabytes = 256;
+    unique_ptr<translation_stats> stats;
+    bool stats_json = false;
+    translator translator;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mmap") == 0) {
+            use_mmap = true;
+        } else if (strcmp(argv[i], "--binary") == 0) {
+            binary = true;
+        } else if (strcmp(argv[i], "--stream") == 0) {
+            stream = true;
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_socket = argv[++i];
+        } else if (strcmp(argv[i], "--client") == 0 && i + 1 < argc) {
+            client_socket = argv[++i];
+        } else if (strcmp(argv[i], "--report") == 0) {
+            client_report = true;
+        } else if (strcmp(argv[i], "--shutdown") == 0) {
+            client_shutdown = true;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(argv[i], "--batch-dir") == 0 && i + 2 < argc) {
+            batch_dir_input = argv[++i];
+            batch_dir_output = argv[++i];
+        } else if (strcmp(argv[i], "--manifest") == 0 && i + 1 < argc) {
+            manifest_path = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--peephole") == 0) {
+            optimizer.reset(new peephole());
+        } else if (strncmp(argv[i], "--peephole=", 11) == 0) {
+            optimizer.reset(new peephole());
+            string error;
+            if (!optimizer->enable_only(argv[i] + 11, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                print_usage();
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc) {
+            cache_megabytes = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            stats.reset(new translation_stats());
+            stats_json = false;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            stats.reset(new translation_stats());
+            stats_json = true;
+        } else if (strcmp(argv[i], "--reachable") == 0) {
+            translator.set_entry("main");
+            reachable = true;
+        } else if (strncmp(argv[i], "--reachable=", 12) == 0) {
+            translator.set_entry(argv[i] + 12);
+            reachable = true;
+        } else if (strcmp(argv[i], "--instrument") == 0) {
+            translator.set_instrument(true);
+        } else if (strcmp(argv[i], "--promote") == 0) {
+            translator.set_promotion(true);
+        } else if (strcmp(argv[i], "--reuse-addresses") == 0) {
+            translator.set_address_reuse(true);
+        } else if (strcmp(argv[i], "--no-liveness") == 0) {
+            translator.set_liveness(false);
+        } else if (strcmp(argv[i], "--noreorder") == 0) {
+            scheduler.reset(new delay_slot_scheduler());
+        } else if (strcmp(argv[i], "--print=inline") == 0) {
+            translator.set_print_mode(translator::PRINT_INLINE);
+        } else if (strcmp(argv[i], "--print=call") == 0) {
+            translator.set_print_mode(translator::PRINT_CALL);
+        } else if (strcmp(argv[i], "--print=auto") == 0) {
+            translator.set_print_mode(translator::PRINT_AUTO);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    // the translation happens in the server, with the server's options
+    if (!client_socket.empty()) {
+        string error;
+        if (client_report || client_shutdown) {
+            if (!client_request(client_socket, client_report ? REQUEST_REPORT : REQUEST_SHUTDOWN, cout, error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+        if (paths.empty() || paths.size() % 2 != 0) {
+            print_usage();
+            return -1;
+        }
+        vector<batch_job> jobs;
+        for (size_t i = 0; i < paths.size(); i += 2) {
+            jobs.push_back({paths[i], paths[i + 1]});
+        }
+        int failures = run_client(client_socket, jobs, binary);
+        return failures == 0 ? 0 : 1;
+    }
+
+    translator.set_optimizer(optimizer.get());
+    translator.set_scheduler(scheduler.get());
+    translator.set_stats(stats.get());
+
+    unique_ptr<translation_cache> cache;
+    if (!cache_dir.empty()) {
+        cache.reset(new translation_cache(cache_dir, cache_megabytes * 1024 * 1024));
+        string error;
+        if (!cache->open(error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        translator.set_cache(cache.get());
+    }
+
+    // a warm translator for clients, until one asks it to shut down
+    if (!serve_socket.empty()) {
+        if (stream || binary || batch || !batch_dir_input.empty() || !manifest_path.empty() || !paths.empty()) {
+            std::cerr << "Error: --serve takes no input, the clients send it" << std::endl;
+            print_usage();
+            return -1;
+        }
+        string error;
+        if (!run_server(translator, serve_socket, thread_count, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        report_run(optimizer.get(), scheduler.get(), cache.get(), stats.get(), stats_json);
+        return 0;
+    }
+
+    if (batch || !batch_dir_input.empty() || !manifest_path.empty()) {
+        vector<batch_job> jobs;
+        string error;
+        if (batch) {
+            if (paths.size() % 2 != 0) {
+                print_usage();
+                return -1;
+            }
+            for (size_t i = 0; i < paths.size(); i += 2) {
+                jobs.push_back({paths[i], paths[i + 1]});
+            }
+        }
+        if (!batch_dir_input.empty() && !jobs_from_directory(batch_dir_input, batch_dir_output, jobs, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+        if (!manifest_path.empty() && !jobs_from_manifest(manifest_path, jobs, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return -1;
+        }
+
+        int failures = run_batch(jobs, translator, use_mmap, binary, thread_count);
+        report_run(optimizer.get(), scheduler.get(), cache.get(), stats.get(), stats_json);
+        if (failures > 0) {
+            std::cerr << failures << " of " << jobs.size() << " files failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // one procedure in memory at a time, stdin and stdout by default
+    if (stream) {
+        if (reachable || binary || paths.size() > 2) {
+            if (reachable || binary) {
+                std::cerr << "Error: " << (reachable ? "--reachable" : "--binary") << " needs the whole input, it cannot be streamed" << std::endl;
+            }
+            print_usage();
+            return -1;
+        }
+        bool to_stdout = paths.size() < 2 || paths[1] == "-";
+        if (translator.get_instrument() && to_stdout) {
+            std::cerr << "Error: --instrument with --stream needs an output file to write <output>.blocks next to" << std::endl;
+            print_usage();
+            return -1;
+        }
+        ifstream input_file;
+        if (paths.size() > 0 && paths[0] != "-") {
+            input_file.open(paths[0]);
+            if (!input_file) {
+                std::cerr << "Error reading " << paths[0] << std::endl;
+                return -1;
+            }
+        }
+        ofstream output_file, block_map;
+        if (!to_stdout) {
+            output_file.open(paths[1]);
+            if (!output_file) {
+                std::cerr << "Error writing to " << paths[1] << std::endl;
+                return -1;
+            }
+            if (translator.get_instrument()) {
+                block_map.open(paths[1] + ".blocks");
+            }
+        }
+        parser parser(input_file.is_open() ? (istream&) input_file : cin);
+        try {
+            translator.translate_stream(parser, output_file.is_open() ? (ostream&) output_file : cout,
+                block_map.is_open() ? &block_map : NULL);
+        } catch (const exception& e) {
+            std::cerr << "Error: " << (paths.size() > 0 ? paths[0] : "-") << ": " << e.what() << std::endl;
+            return 1;
+        }
+        if (translator.get_instrument()) {
+            block_map.close();
+            if (!block_map) {
+                std::cerr << "Error: error writing " << paths[1] << ".blocks" << std::endl;
+            }
+        }
+        report_run(optimizer.get(), scheduler.get(), cache.get(), stats.get(), stats_json);
+        return 0;
+    }
+
+    if (paths.size() < 2) {
+        print_usage();
         return -1;
     }
-    // TODO transfer all upper-case letters
 
-    string input_file_path(argv[1]);
-    parser parser(input_file_path);
-    translator translator;
-    string output = translator.translate_IA32_to_MIPS(parser);
-
-    // TODO write output to argv[2];
-    string output_file_path(argv[2]);
-    ofstream os(output_file_path);  
-    if (!os) { 
-        std::cerr<<"Error writing to " << argv[2] <<std::endl; 
-    } else {  
-      os << output;
-    }  
+    string input_file_path(paths[0]);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    // throws for input beyond what a program can hold, see parser.h
+    unique_ptr<parser> input;
+    try {
+        input.reset(new parser(input_file_path, use_mmap));
+    } catch (const exception& e) {
+        std::cerr << "Error: " << input_file_path << ": " << e.what() << std::endl;
+        return 1;
+    }
+    parser& parser = *input;
+    if (!parser.is_loaded()) {
+        std::cerr << "Error: cannot read " << input_file_path << std::endl;
+        return 1;
+    }
+    if (stats) {
+        stats->add_parse_time(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+
+    // procedures of one file are spread over the cores too, when there are
+    // enough of them or --jobs asks for it
+    unique_ptr<thread_pool> pool;
+    if (thread_count > 1
+            || (thread_count == 0 && parser.get_program().instruction_count() >= translator::MIN_PARALLEL_INSTRUCTIONS)) {
+        pool.reset(new thread_pool(thread_count));
+    }
+
+    string output_file_path(paths[1]);
+    ofstream os;
+    if (!binary) {
+        os.open(output_file_path);
+    }
+    if (!binary && !os) {
+        std::cerr<<"Error writing to " << output_file_path <<std::endl;
+    } else {
+      string error;
+      if (binary) {
+          ostringstream assembly;
+          translator.translate_IA32_to_MIPS(parser, assembly, pool.get());
+          if (!write_binary(assembly.str(), output_file_path, error)) {
+              std::cerr << "Error: " << error << std::endl;
+              return 1;
+          }
+      } else {
+          translator.translate_IA32_to_MIPS(parser, os, pool.get());
+          start = chrono::steady_clock::now();
+          os.close();
+          if (stats) {
+              stats->add_write_time(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+          }
+      }
+      if (translator.get_instrument() && !write_block_map(translator, parser, output_file_path, error)) {
+          std::cerr << "Error: " << error << std::endl;
+      }
+      report_run(optimizer.get(), scheduler.get(), cache.get(), stats.get(), stats_json);
+    }
     return 0;
 }
@@ -0,0 +1,81 @@
+#include "opcode.h"
+
+uint64_t pack_name(text_ref name) {
+	if (name.size() > 8) { // longer than any opcode or register
+		return 0;
+	}
+	uint64_t packed = 0;
+	for (size_t i = 0; i < name.size(); i++) {
+		packed |= (uint64_t) (unsigned char) name[i] << (8 * i);
+	}
+	return packed;
+}
+
+opcode_id lookup_opcode(text_ref name) {
+	switch (pack_name(name)) {
+		case pack_name("movl"): return OP_MOVL;
+		case pack_name("addl"): return OP_ADDL;
+		case pack_name("subl"): return OP_SUBL;
+		case pack_name("andl"): return OP_ANDL;
+		case pack_name("orl"): return OP_ORL;
+		case pack_name("xorl"): return OP_XORL;
+		case pack_name("imull"): return OP_IMULL;
+		case pack_name("idivl"): return OP_IDIVL;
+		case pack_name("cltd"): return OP_CLTD;
+		case pack_name("sall"): return OP_SALL;
+		case pack_name("shll"): return OP_SHLL;
+		case pack_name("sarl"): return OP_SARL;
+		case pack_name("shrl"): return OP_SHRL;
+		case pack_name("incl"): return OP_INCL;
+		case pack_name("decl"): return OP_DECL;
+		case pack_name("negl"): return OP_NEGL;
+		case pack_name("notl"): return OP_NOTL;
+		case pack_name("pushl"): return OP_PUSHL;
+		case pack_name("popl"): return OP_POPL;
+		case pack_name("call"): return OP_CALL;
+		case pack_name("leave"): return OP_LEAVE;
+		case pack_name("ret"): return OP_RET;
+		case pack_name("cmpl"): return OP_CMPL;
+		case pack_name("jmp"): return OP_JMP;
+		case pack_name("je"): return OP_JE;
+		case pack_name("jne"): return OP_JNE;
+		case pack_name("jl"): return OP_JL;
+		case pack_name("jle"): return OP_JLE;
+		case pack_name("jg"): return OP_JG;
+		case pack_name("jge"): return OP_JGE;
+		case pack_name("prn"): return OP_PRN;
+		case pack_name("int"): return OP_INT;
+		default: return OP_UNKNOWN;
+	}
+}
+
+static const char* const OPCODE_NAMES[OP_COUNT] = {
+	"unknown",
+	"movl",
+	"addl", "subl", "andl", "orl", "xorl",
+	"imull", "idivl", "cltd",
+	"sall", "shll", "sarl", "shrl",
+	"incl", "decl", "negl", "notl",
+	"pushl", "popl",
+	"call", "leave", "ret",
+	"cmpl", "jmp", "je", "jne", "jl", "jle", "jg", "jge",
+	"prn", "int"
+};
+
+const char* opcode_name(opcode_id opcode) {
+	return opcode < OP_COUNT ? OPCODE_NAMES[opcode] : OPCODE_NAMES[OP_UNKNOWN];
+}
+
+register_id lookup_register(text_ref name) {
+	switch (pack_name(name)) {
+		case pack_name("%eax"): return REG_EAX;
+		case pack_name("%ecx"): return REG_ECX;
+		case pack_name("%edx"): return REG_EDX;
+		case pack_name("%ebx"): return REG_EBX;
+		case pack_name("%esi"): return REG_ESI;
+		case pack_name("%edi"): return REG_EDI;
+		case pack_name("%esp"): return REG_ESP;
+		case pack_name("%ebp"): return REG_EBP;
+		default: return REG_NONE;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef OPCODE_H
+#define OPCODE_H
+
+#include <stdint.h>
+#include "text_ref.h"
+
+using namespace std;
+
+// interned IA32 opcodes, resolved once by the parser
+enum opcode_id {
+	OP_UNKNOWN,
+	OP_MOVL,
+	OP_ADDL, OP_SUBL, OP_ANDL, OP_ORL, OP_XORL,
+	OP_IMULL, OP_IDIVL, OP_CLTD,
+	OP_SALL, OP_SHLL, OP_SARL, OP_SHRL,
+	OP_INCL, OP_DECL, OP_NEGL, OP_NOTL,
+	OP_PUSHL, OP_POPL,
+	OP_CALL, OP_LEAVE, OP_RET,
+	OP_CMPL, OP_JMP, OP_JE, OP_JNE, OP_JL, OP_JLE, OP_JG, OP_JGE,
+	OP_PRN, OP_INT,
+	OP_COUNT
+};
+
+// the eight IA32 registers, followed by the registers the translator uses internally
+enum register_id {
+	REG_NONE,
+	REG_EAX, REG_ECX, REG_EDX, REG_EBX, REG_ESI, REG_EDI, REG_ESP, REG_EBP,
+	REG_TEMP, REG_ADDRESSING_RESULT, REG_ZERO,
+	REG_COUNT
+};
+
+// a set of registers, one bit per register_id
+typedef uint16_t register_set;
+
+inline register_set register_bit(register_id reg) {
+	return reg == REG_NONE ? 0 : (register_set) (1 << reg);
+}
+
+// packs a name of up to 8 characters into an integer, so names can be
+// compared (and switched on) as a single word
+constexpr uint64_t pack_name(const char* s, int i = 0) {
+	return (i == 8 || s[i] == '\0') ? 0
+		: ((uint64_t) (unsigned char) s[i] << (8 * i)) | pack_name(s, i + 1);
+}
+
+uint64_t pack_name(text_ref name);
+
+opcode_id lookup_opcode(text_ref name);
+// the mnemonic of an opcode, "unknown" for OP_UNKNOWN
+const char* opcode_name(opcode_id opcode);
+register_id lookup_register(text_ref name);
+
+#endif
@@ -0,0 +1,107 @@
+#include "operand.h"
+#include <stdlib.h>
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static text_ref trim(const char* begin, const char* end) {
+	while (begin != end && is_blank(*begin)) {
+		begin++;
+	}
+	while (end != begin && is_blank(*(end - 1))) {
+		end--;
+	}
+	return text_ref(begin, end);
+}
+
+// decimal, 0x hexadecimal or 0 octal, with an optional sign
+static int parse_number(text_ref text) {
+	char buffer[32];
+	size_t len = text.size() < sizeof(buffer) - 1 ? text.size() : sizeof(buffer) - 1;
+	memcpy(buffer, text.data(), len);
+	buffer[len] = '\0';
+	return (int) strtol(buffer, NULL, 0);
+}
+
+static bool all_digits(text_ref text) {
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] < '0' || text[i] > '9') {
+			return false;
+		}
+	}
+	return true;
+}
+
+operand_desc decode_operand(text_ref text) {
+	operand_desc op;
+	op.kind = OPERAND_NONE;
+	op.base = REG_NONE;
+	op.index = REG_NONE;
+	op.scale = 1;
+	op.displacement = 0;
+	op.immediate = 0;
+	op.text = text;
+
+	if (text.empty()) {
+		return op;
+	}
+
+	if (text[0] == '%') {
+		op.kind = OPERAND_REGISTER;
+		op.base = lookup_register(text);
+		return op;
+	}
+
+	if (text[0] == '$') {
+		op.kind = OPERAND_IMMEDIATE;
+		op.value_text = text_ref(text.begin() + 1, text.end());
+		op.immediate = parse_number(op.value_text);
+		return op;
+	}
+
+	const char* open_paren = (const char*) memchr(text.data(), '(', text.size());
+	const char* close_paren = (const char*) memchr(text.data(), ')', text.size());
+	if (open_paren != NULL && close_paren != NULL) {
+		// split the parenthesized part on commas
+		text_ref parts[3];
+		int comma_count = 0;
+		const char* part_begin = open_paren + 1;
+		for (const char* c = text.begin(); c != text.end(); c++) {
+			if (*c != ',') {
+				continue;
+			}
+			if (comma_count < 2 && c > open_paren && c < close_paren) {
+				parts[comma_count] = trim(part_begin, c);
+				part_begin = c + 1;
+			}
+			comma_count++;
+		}
+		if (comma_count > 2) {
+			op.kind = OPERAND_LABEL;
+			return op;
+		}
+		parts[comma_count] = trim(part_begin, close_paren);
+
+		op.kind = comma_count == 0 ? OPERAND_INDIRECT
+			: comma_count == 1 ? OPERAND_INDEXED : OPERAND_SCALED_INDEXED;
+		op.value_text = text_ref(text.begin(), open_paren);
+		op.displacement = parse_number(op.value_text);
+		op.base = lookup_register(parts[0]);
+		op.index = lookup_register(parts[1]);
+		if (comma_count == 2) {
+			op.scale = parse_number(parts[2]);
+		}
+		return op;
+	}
+
+	if (all_digits(text)) {
+		op.kind = OPERAND_ABSOLUTE;
+		op.value_text = text;
+		op.displacement = parse_number(text);
+		return op;
+	}
+
+	op.kind = OPERAND_LABEL;
+	return op;
+}
@@ -0,0 +1,40 @@
+#ifndef OPERAND_H
+#define OPERAND_H
+
+#include "text_ref.h"
+#include "opcode.h"
+
+using namespace std;
+
+enum operand_kind {
+	OPERAND_NONE,
+	OPERAND_REGISTER,       // %eax
+	OPERAND_IMMEDIATE,      // $imm
+	OPERAND_ABSOLUTE,       // imm
+	OPERAND_INDIRECT,       // disp(%base)
+	OPERAND_INDEXED,        // disp(%base, %index)
+	OPERAND_SCALED_INDEXED, // disp(%base, %index, scale)
+	OPERAND_LABEL           // jump and call targets, and anything else
+};
+
+// an operand decoded once by the parser, so the translator never has to
+// re-scan its text
+struct operand_desc {
+	operand_kind kind;
+	register_id base;     // the register of a register operand, or the base of a memory operand
+	register_id index;
+	int scale;
+	int displacement;     // offset of a memory operand, or the address of an absolute one
+	int immediate;
+	text_ref text;        // the operand as written
+	text_ref value_text;  // immediate without '$', displacement or absolute address as written
+
+	bool is_memory() const {
+		return kind == OPERAND_ABSOLUTE || kind == OPERAND_INDIRECT
+			|| kind == OPERAND_INDEXED || kind == OPERAND_SCALED_INDEXED;
+	}
+};
+
+operand_desc decode_operand(text_ref text);
+
+#endif
@@ -1,89 +1,313 @@
 #include "parser.h"
+#include "cfg.h"
+#include "liveness.h"
+#include "promotion.h"
+#include "addressing.h"
 #include <fstream>
-#include <sstream>
-#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-parser::parser(string file_name) {
-	ifstream infile(file_name);
-	string buffer;
-	block* current_block = NULL;
+parser::parser(string file_name, bool use_mmap) : file_name(file_name), loaded(false), line_number(0), stream(NULL) {
+	if (!use_mmap || !read_mapped()) {
+		loaded = read_stream();
+	} else {
+		loaded = true;
+	}
+}
 
-	while (getline(infile, buffer)) {
-		buffer = filter_comment(buffer);
-		transform(buffer.begin(), buffer.end(), buffer.begin(), ::tolower);
+parser::parser(istream& in) : loaded(true), line_number(0), stream(&in) {}
 
-		// new block, and update current_block pointer
-		if (is_label(buffer)) {
-			string label = get_label(buffer);
-			block* new_block = new block(label);
-			code_blocks.push_back(new_block);
-			label_dic.insert({label, code_blocks.size() - 1});
+parser::parser(const char* text, size_t size) : loaded(true), line_number(0), stream(NULL) {
+	load(text, size);
+}
 
-			current_block = new_block;
-		}
+parser::parser(const string* lines, size_t count) : loaded(true), line_number(0), stream(NULL) {
+	load(lines, count);
+}
+
+void parser::load(const char* text, size_t size) {
+	prog.clear();
+	label_dic.clear();
+	line_number = 0;
+	check_text_size(size);
+	string& owned = prog.get_owned_text();
+	owned.assign(text, size);
+	if (owned.empty()) {
+		return;
+	}
+	prog.use_owned_text();
+	parse_buffer(&owned[0], &owned[0] + owned.size());
+}
+
+void parser::load(const string* lines, size_t count) {
+	prog.clear();
+	label_dic.clear();
+	line_number = 0;
+	string& owned = prog.get_owned_text();
+	for (size_t i = 0; i < count; i++) {
+		owned += lines[i];
+		owned += '\n';
+	}
+	check_text_size(owned.size());
+	if (owned.empty()) {
+		return;
+	}
+	prog.use_owned_text();
+	parse_buffer(&owned[0], &owned[0] + owned.size());
+}
+
+bool parser::next_procedure() {
+	prog.clear();
+	label_dic.clear();
+	string& text = prog.get_owned_text();
+	string buffer;
+	bool is_procedure_head = true; // as split into procedures by the translator
+	while (getline(*stream, buffer)) {
+		line_number++;
+		size_t block_count = prog.block_count(), instruction_count = prog.instruction_count();
+		size_t line_begin = text.size();
+		text += buffer;
+		check_text_size(text.size());
+		prog.use_owned_text();
+		parse_line(&text[line_begin], &text[0] + text.size());
 
-		instruction* new_instr = extract_instruction(buffer);
-		if (new_instr != NULL) {
-			current_block->push_back_instruction(new_instr);
+		bool labeled = prog.block_count() > 0 && !prog.get_block_label(prog.block_count() - 1).empty();
+		if (prog.block_count() > block_count && labeled) {
+			is_procedure_head = false;
 		}
+		if (prog.instruction_count() > instruction_count) {
+			opcode_id opcode = prog.get_opcode(prog.instruction_count() - 1);
+			if (opcode == OP_LEAVE) {
+				is_procedure_head = true;
+			} else if (opcode == OP_RET && is_procedure_head && labeled) {
+				return true;
+			}
+		}
+	}
+	return prog.block_count() > 0;
+}
+
+bool parser::read_stream() {
+	ifstream infile(file_name);
+	if (!infile) {
+		return false;
+	}
+
+	// the whole file is kept as the program's string table, and scanned in
+	// one go like a mapped one
+	string& text = prog.get_owned_text();
+	infile.seekg(0, ios::end);
+	streamoff size = infile.tellg();
+	infile.seekg(0, ios::beg);
+	if (size > 0) {
+		check_text_size(size);
+		text.reserve(size);
+	}
+	char buffer[64 * 1024];
+	while (infile.read(buffer, sizeof(buffer)) || infile.gcount() > 0) {
+		text.append(buffer, infile.gcount());
+		check_text_size(text.size());
+	}
+	if (text.empty()) {
+		return true;
 	}
+	prog.use_owned_text();
+	parse_buffer(&text[0], &text[0] + text.size());
+	return true;
 }
 
-string parser::filter_comment(string line) {
-	size_t pound_pos = line.find("#");
-	return line.substr(0, pound_pos);
+bool parser::read_mapped() {
+	int fd = open(file_name.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return false;
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return true;
+	}
+	if ((uint64_t) st.st_size > program::MAX_TEXT_SIZE) {
+		close(fd);
+		check_text_size(st.st_size);
+	}
+
+	// private writable mapping: lower-casing in place only copies the pages it touches
+	void* addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		return false;
+	}
+	madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+	char* text = (char*) addr;
+	prog.adopt_mapping(text, st.st_size);
+	prog.use_mapping();
+
+	// at most one instruction per line
+	size_t line_count = 1;
+	for (char* c = text; (c = (char*) memchr(c, '\n', text + st.st_size - c)) != NULL; c++) {
+		line_count++;
+	}
+	prog.reserve(line_count);
+
+	parse_buffer(text, text + st.st_size);
+	return true;
 }
 
-bool parser::is_label(string line) {
-	return line.find(":") != string::npos;
+void parser::parse_buffer(char* begin, char* end) {
+	line_scanner scanner(begin, end);
+	scanned_line line;
+	while (scanner.next(line)) {
+		line_number++;
+		parse_line(line);
+	}
 }
 
-string parser::get_label(string line) {
-	size_t column_pos = line.find(":");
-	if (column_pos == string::npos) {
-		return "";
-	} else {
-		return line.substr(0, column_pos);
+void parser::parse_line(char* begin, char* end) {
+	line_scanner scanner(begin, end);
+	scanned_line line;
+	if (scanner.next(line)) {
+		parse_line(line);
 	}
 }
 
-instruction* parser::extract_instruction(string line) {
-	// skip label
-	size_t column_pos = line.find(":");
-	if (column_pos != string::npos) {
-		line = line.substr(column_pos + 1);
+void parser::parse_line(const scanned_line& line) {
+	char* begin = line.begin;
+
+	// new block
+	if (line.colon != NULL) {
+		text_ref label(begin, line.colon);
+		prog.add_block(label, line_number);
+		label_dic.insert({label.str(), prog.block_count() - 1});
+
+		begin = line.colon + 1;
 	}
 
-	vector<string> inst;
+	extract_instruction(begin, line.code_end);
+}
+
+static bool is_blank(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+void parser::extract_instruction(char* begin, char* end) {
+	text_ref inst[3];
+	int count = 0;
+
+	char* p = begin;
+	while (true) {
+		while (p != end && is_blank(*p)) {
+			p++;
+		}
+		if (p == end) {
+			break;
+		}
+		if (count == 3) { // more than three words
+			return;
+		}
+
+		// a word ends at whitespace, unless it opened a parenthesis that is not closed yet
+		char* word_begin = p;
+		bool open_paren = false, close_paren = false;
+		while (true) {
+			while (p != end && !is_blank(*p)) {
+				open_paren |= *p == '(';
+				close_paren |= *p == ')';
+				p++;
+			}
+			if (!open_paren || close_paren) {
+				break;
+			}
+			char* next = p;
+			while (next != end && is_blank(*next)) {
+				next++;
+			}
+			if (next == end) {
+				break;
+			}
+			p = next;
+		}
 
-	string word;
-	istringstream iss(line, istringstream::in);
-	while (iss >> word) {
-		while (word.find("(") != string::npos && word.find(")") == string::npos) {
-			string temp;
-			iss >> temp;
-			word += temp;
+		char* word_end = p;
+		if (*(word_end - 1) == ',') {
+			word_end--;
 		}
+		inst[count++] = text_ref(word_begin, word_end);
+	}
 
-		if (word.at(word.size()-1) == ',') {
-			word = word.substr(0, word.size() - 1);
+	if (count == 0) {
+		return;
+	}
+	operand_desc operands[2];
+	for (int n = 0; n < 2; n++) {
+		if (inst[n + 1].size() > program::MAX_OPERAND_SIZE) {
+			throw length_error("line " + to_string(line_number) + ": operand of " + to_string(inst[n + 1].size())
+				+ " characters, at most " + to_string(program::MAX_OPERAND_SIZE) + " are supported");
+		}
+		operands[n] = decode_operand(inst[n + 1]);
+		if (operands[n].kind == OPERAND_SCALED_INDEXED && (operands[n].scale < 0 || operands[n].scale > program::MAX_SCALE)) {
+			throw invalid_argument("line " + to_string(line_number) + ": scale " + to_string(operands[n].scale)
+				+ " in " + inst[n + 1].str() + ", it must be 0 to " + to_string(program::MAX_SCALE));
 		}
-		inst.push_back(word);
 	}
+	prog.add_instruction(lookup_opcode(inst[0]), operands[0], operands[1]);
+}
 
-	switch(inst.size()) {
-		case 1: return new instruction(inst[0]);
-		case 2: return new instruction(inst[0], inst[1]);
-		case 3: return new instruction(inst[0], inst[1], inst[2]);
-		default: return NULL;
+void parser::check_text_size(uint64_t size) {
+	if (size > program::MAX_TEXT_SIZE) {
+		throw length_error("input of " + to_string(size) + " bytes, at most " + to_string(program::MAX_TEXT_SIZE)
+			+ " are supported");
 	}
 }
 
 
-vector<block*> parser::get_code_blocks() {
-	return code_blocks;
+bool parser::is_loaded() {
+	return loaded;
+}
+
+void parser::analyze_liveness() {
+	if (prog.has_liveness()) {
+		return;
+	}
+	control_flow_graph cfg(prog, label_dic);
+	liveness live(prog, cfg);
+	prog.set_live_after(live.get_live_after());
+}
+
+void parser::analyze_frames() {
+	if (prog.has_frame_plans()) {
+		return;
+	}
+	control_flow_graph cfg(prog, label_dic);
+	frame_promotion promotion(prog, cfg, label_dic);
+	vector<frame_plan> plans = promotion.get_plans();
+	prog.set_frame_plans(plans);
+}
+
+void parser::analyze_addresses() {
+	if (prog.has_address_uses()) {
+		return;
+	}
+	address_reuse reuse(prog);
+	prog.set_address_uses(reuse.get_uses());
+}
+
+const program& parser::get_program() {
+	return prog;
+}
+
+index_range<block> parser::get_code_blocks() {
+	return prog.get_blocks();
 }
 
-unordered_map<string, int> parser::get_label_dic() {
+const unordered_map<string, int>& parser::get_label_dic() {
 	return label_dic;
 }
@@ -4,8 +4,12 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <istream>
+#include "text_ref.h"
 #include "instruction.h"
 #include "block.h"
+#include "program.h"
+#include "scanner.h"
 
 using namespace std;
 
@@ -13,21 +17,68 @@ class parser {
 private:
 	string file_name;
 
-	vector<block*> code_blocks;
+	program prog;
 	unordered_map<string, int> label_dic;
+	bool loaded;
+	uint32_t line_number; // of the line being parsed
+	istream* stream;      // read one procedure at a time when set
 
 	/** helper method **/
-	string filter_comment(string line);
-	bool is_label(string line);
-	string get_label(string line);
-	instruction* extract_instruction(string line);
+	bool read_stream();
+	bool read_mapped();
+	void parse_buffer(char* begin, char* end);
+	// one line without its newline
+	void parse_line(char* begin, char* end);
+	void parse_line(const scanned_line& line);
+	void extract_instruction(char* begin, char* end);
+	// length_error when the input is too large for the program's offsets
+	void check_text_size(uint64_t size);
 
 public:
-	parser(string file_name);
+	// use_mmap maps the input file and tokenizes it in place, the default
+	// path reads it line by line
+	parser(string file_name, bool use_mmap = false);
+	// reads in one procedure at a time with next_procedure, the stream must
+	// outlive the parser
+	parser(istream& in);
+	// parses a program held in memory, which is copied: the caller's buffer
+	// is not needed afterwards.
+	// Every way of reading throws length_error for input of more than
+	// program::MAX_TEXT_SIZE bytes or an operand of more than
+	// program::MAX_OPERAND_SIZE characters, and invalid_argument for a
+	// scale outside 0 to program::MAX_SCALE
+	parser(const char* text, size_t size);
+	// the lines of a program, without their newlines
+	parser(const string* lines, size_t count);
 
-	vector<block*> get_code_blocks();
-	unordered_map<string, int> get_label_dic();
+	// replaces the program with the one in text or lines, keeping the memory
+	// of the last one, so a parser can be reused for many small inputs
+	void load(const char* text, size_t size);
+	void load(const string* lines, size_t count);
 
+	// replaces the program with the next procedure of the stream: its lines
+	// up to the ret after its leave (or to the end of the input when it has
+	// none). False when the input is used up. The label dictionary holds the
+	// procedure's own labels, jumps to others are left unresolved
+	bool next_procedure();
+
+	// false if the input file could not be read
+	bool is_loaded();
+
+	// builds the control flow graph and stores the registers live after
+	// each instruction in the program; does nothing the second time
+	void analyze_liveness();
+	// finds the frame slots each procedure can keep in registers and stores
+	// them in the program; does nothing the second time
+	void analyze_frames();
+	// decides which indexed addresses are reused from an address register
+	// and stores that in the program, after analyze_frames when frames are
+	// promoted; does nothing the second time
+	void analyze_addresses();
+
+	const program& get_program();
+	index_range<block> get_code_blocks();
+	const unordered_map<string, int>& get_label_dic();
 };
 
-#endif 
+#endif
@@ -0,0 +1,253 @@
+#include "peephole.h"
+#include <sstream>
+
+static bool same_operand(const mips_operand& a, const mips_operand& b) {
+	if (a.kind != b.kind || a.negate != b.negate) {
+		return false;
+	}
+	switch (a.kind) {
+		case mips_operand::TEXT: return a.text == b.text;
+		case mips_operand::NUMBER: return a.number == b.number;
+		case mips_operand::MEMORY: return a.text == b.text && a.reg == b.reg;
+		default: return a.number == b.number && a.reg == b.reg;
+	}
+}
+
+static bool is_stack_top(const mips_operand& operand) {
+	return operand.is("0($sp)")
+		|| (operand.kind == mips_operand::NUMBER_MEMORY && operand.number == 0 && operand.reg == "$sp");
+}
+
+static bool is_stack_adjust(const mips_instruction& instr, const char* amount) {
+	return instr.is("addi") && instr.operand_count == 3
+		&& instr.operands[0].is("$sp") && instr.operands[1].is("$sp") && instr.operands[2].is(amount);
+}
+
+static mips_instruction make_instruction(text_ref op, initializer_list<mips_operand> operands) {
+	mips_instruction instr;
+	instr.kind = mips_instruction::INSTRUCTION;
+	instr.tab_num = 1;
+	instr.op = op;
+	instr.operand_count = 0;
+	for (auto iter = operands.begin(); iter != operands.end(); iter++) {
+		instr.operands[instr.operand_count++] = *iter;
+	}
+	return instr;
+}
+
+// matches the code of one pushl at code[i]:
+//     addi $sp, $sp, -4
+//     [li $s7, value]
+//     sw reg, 0($sp)
+// and returns its length, 0 if there is none. Pushes of $sp itself are left alone
+static size_t match_push(const vector<mips_instruction>& code, size_t i) {
+	if (i >= code.size() || !is_stack_adjust(code[i], "-4")) {
+		return 0;
+	}
+	size_t len = 1;
+	if (i + len < code.size() && code[i + len].is("li") && code[i + len].operands[0].is("$s7")) {
+		len++;
+	}
+	if (i + len >= code.size()) {
+		return 0;
+	}
+	const mips_instruction& store = code[i + len];
+	if (!store.is("sw") || store.operand_count != 2 || !is_stack_top(store.operands[1]) || store.operands[0].is("$sp")) {
+		return 0;
+	}
+	return len + 1;
+}
+
+// matches the code of one popl at code[i]:
+//     lw reg, 0($sp)
+//     addi $sp, $sp, 4
+static bool match_pop(const vector<mips_instruction>& code, size_t i) {
+	return i + 1 < code.size()
+		&& code[i].is("lw") && code[i].operand_count == 2 && is_stack_top(code[i].operands[1])
+		&& !code[i].operands[0].is("$sp")
+		&& is_stack_adjust(code[i + 1], "4");
+}
+
+/** rules **/
+
+// pushl x followed by popl reg is a move, or nothing when x is reg. The slot
+// written below the stack pointer is dead, and so is $s7 after the store
+static size_t rule_push_pop(vector<mips_instruction>& code) {
+	vector<mips_instruction> result;
+	result.reserve(code.size());
+	size_t removed = 0;
+	for (size_t i = 0; i < code.size(); ) {
+		size_t push_len = match_push(code, i);
+		if (push_len == 0 || !match_pop(code, i + push_len)) {
+			result.push_back(code[i++]);
+			continue;
+		}
+		const mips_operand& value = code[i + push_len - 1].operands[0];
+		const mips_operand& target = code[i + push_len].operands[0];
+		size_t len = push_len + 2;
+		if (push_len == 3) {
+			result.push_back(make_instruction("li", {target, code[i + 1].operands[1]}));
+			removed += len - 1;
+		} else if (same_operand(value, target)) {
+			removed += len;
+		} else {
+			result.push_back(make_instruction("add", {target, "$zero", value}));
+			removed += len - 1;
+		}
+		i += len;
+	}
+	code.swap(result);
+	return removed;
+}
+
+// consecutive pushes, as emitted for a pushl batch or the arguments of a
+// call, share one stack adjustment
+static size_t rule_push_merge(vector<mips_instruction>& code) {
+	vector<mips_instruction> result;
+	result.reserve(code.size());
+	size_t removed = 0;
+	for (size_t i = 0; i < code.size(); ) {
+		vector<size_t> pushes; // start of each push in the run
+		size_t end = i;
+		for (size_t len; (len = match_push(code, end)) != 0; end += len) {
+			pushes.push_back(end);
+		}
+		if (pushes.size() < 2) {
+			result.push_back(code[i++]);
+			continue;
+		}
+
+		int count = pushes.size();
+		result.push_back(make_instruction("addi", {"$sp", "$sp", mips_operand::num(-4 * count)}));
+		for (int j = 0; j < count; j++) {
+			size_t push_end = j + 1 < count ? pushes[j + 1] : end;
+			for (size_t k = pushes[j] + 1; k + 1 < push_end; k++) { // the li, if any
+				result.push_back(code[k]);
+			}
+			mips_instruction store = code[push_end - 1];
+			store.operands[1] = mips_operand::memory(4 * (count - 1 - j), "$sp");
+			result.push_back(store);
+		}
+		removed += count - 1;
+		i = end;
+	}
+	code.swap(result);
+	return removed;
+}
+
+// li $s7, 0 only to store it: store $zero instead
+static size_t rule_store_zero(vector<mips_instruction>& code) {
+	vector<mips_instruction> result;
+	result.reserve(code.size());
+	size_t removed = 0;
+	for (size_t i = 0; i < code.size(); i++) {
+		if (i + 1 < code.size()
+				&& code[i].is("li") && code[i].operands[0].is("$s7") && code[i].operands[1].is("0")
+				&& code[i + 1].is("sw") && code[i + 1].operands[0].is("$s7")) {
+			mips_instruction store = code[i + 1];
+			store.operands[0] = "$zero";
+			result.push_back(store);
+			removed++;
+			i++;
+			continue;
+		}
+		result.push_back(code[i]);
+	}
+	code.swap(result);
+	return removed;
+}
+
+// the empty line written after every compare-and-branch
+static size_t rule_blank_line(vector<mips_instruction>& code) {
+	size_t kept = 0;
+	for (size_t i = 0; i < code.size(); i++) {
+		if (code[i].kind != mips_instruction::BLANK_LINE) {
+			code[kept++] = code[i];
+		}
+	}
+	size_t removed = code.size() - kept;
+	code.resize(kept);
+	return removed;
+}
+
+// applied in this order, new rules are added here
+static const peephole_rule RULES[] = {
+	{"push-pop", "pushl immediately followed by popl becomes a move", rule_push_pop},
+	{"push-merge", "consecutive pushes share one $sp adjustment", rule_push_merge},
+	{"store-zero", "li $s7, 0 and sw $s7 become sw $zero", rule_store_zero},
+	{"blank-line", "drop the blank line after compare-and-branch", rule_blank_line},
+};
+static const size_t RULE_COUNT = sizeof(RULES) / sizeof(RULES[0]);
+
+const peephole_rule* peephole::get_rules(size_t& count) {
+	count = RULE_COUNT;
+	return RULES;
+}
+
+peephole::peephole() : removed(new atomic<size_t>[RULE_COUNT]) {
+	for (size_t r = 0; r < RULE_COUNT; r++) {
+		enabled.push_back(r);
+		removed[r] = 0;
+	}
+}
+
+bool peephole::enable_only(const string& names, string& error) {
+	vector<bool> chosen(RULE_COUNT, false);
+	stringstream list(names);
+	string name;
+	while (getline(list, name, ',')) {
+		if (name.empty() || name == "none") {
+			continue;
+		}
+		if (name == "all") {
+			chosen.assign(RULE_COUNT, true);
+			continue;
+		}
+		size_t r = 0;
+		while (r < RULE_COUNT && name != RULES[r].name) {
+			r++;
+		}
+		if (r == RULE_COUNT) {
+			error = "unknown peephole rule " + name;
+			return false;
+		}
+		chosen[r] = true;
+	}
+
+	enabled.clear();
+	for (size_t r = 0; r < RULE_COUNT; r++) {
+		if (chosen[r]) {
+			enabled.push_back(r);
+		}
+	}
+	return true;
+}
+
+void peephole::optimize(vector<mips_instruction>& code) {
+	for (auto r = enabled.begin(); r != enabled.end(); r++) {
+		size_t count = RULES[*r].apply(code);
+		if (count > 0) {
+			removed[*r] += count;
+		}
+	}
+}
+
+string peephole::describe() const {
+	string names;
+	for (auto r = enabled.begin(); r != enabled.end(); r++) {
+		if (!names.empty()) {
+			names += ',';
+		}
+		names += RULES[*r].name;
+	}
+	return names;
+}
+
+void peephole::report(ostream& os) const {
+	size_t total = 0;
+	for (auto r = enabled.begin(); r != enabled.end(); r++) {
+		os << "peephole " << RULES[*r].name << ": " << removed[*r] << " removed" << endl;
+		total += removed[*r];
+	}
+	os << "peephole total: " << total << " removed" << endl;
+}
@@ -0,0 +1,50 @@
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include "emitter.h"
+
+using namespace std;
+
+// a rewrite over a straight run of emitted instructions, returns how many
+// instructions (or blank lines) it removed
+typedef size_t (*peephole_apply)(vector<mips_instruction>& code);
+
+struct peephole_rule {
+	const char* name;
+	const char* description;
+	peephole_apply apply;
+};
+
+// runs the enabled rules, in table order, over the instructions an emitter
+// holds back between two labels. One instance can serve the emitters of
+// several threads, the counters are atomic
+class peephole {
+private:
+	vector<size_t> enabled; // indexes into the rule table
+	unique_ptr<atomic<size_t>[]> removed; // per rule of the table
+
+public:
+	// all rules enabled
+	peephole();
+
+	// names is a comma separated list of rule names, "all" or "none".
+	// Returns false and names the offender in error for an unknown rule
+	bool enable_only(const string& names, string& error);
+
+	void optimize(vector<mips_instruction>& code);
+
+	// the enabled rules, comma separated
+	string describe() const;
+
+	// one line per enabled rule with the instructions it removed
+	void report(ostream& os) const;
+
+	static const peephole_rule* get_rules(size_t& count);
+};
+
+#endif
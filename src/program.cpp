@@ -0,0 +1,191 @@
+#include "program.h"
+#include <sys/mman.h>
+
+program::program() : mapped_text(NULL), mapped_size(0), strings(NULL), opcode_counts(OP_COUNT, 0),
+	frames_analyzed(false) {}
+
+void program::adopt_mapping(char* text, size_t size) {
+	mapped_text = text;
+	mapped_size = size;
+}
+
+string& program::get_owned_text() {
+	return owned_text;
+}
+
+void program::use_mapping() {
+	strings = mapped_text;
+}
+
+void program::use_owned_text() {
+	strings = owned_text.data();
+}
+
+void program::reserve(size_t instruction_count) {
+	opcodes.reserve(instruction_count);
+	operands.reserve(2 * instruction_count);
+}
+
+void program::clear() {
+	owned_text.clear();
+	opcodes.clear();
+	operands.clear();
+	block_first.clear();
+	label_offsets.clear();
+	label_sizes.clear();
+	label_lines.clear();
+	opcode_counts.assign(OP_COUNT, 0);
+	live_after.clear();
+	frame_plans.clear();
+	frames_analyzed = false;
+	address_uses.clear();
+}
+
+void program::add_block(text_ref label, uint32_t line) {
+	block_first.push_back(opcodes.size());
+	label_offsets.push_back(label.empty() ? 0 : label.data() - strings);
+	label_sizes.push_back(label.size());
+	label_lines.push_back(line);
+}
+
+void program::add_instruction(opcode_id opcode, const operand_desc& operand1, const operand_desc& operand2) {
+	if (block_first.empty()) { // code before the first label
+		add_block(text_ref());
+	}
+	opcodes.push_back(opcode);
+	opcode_counts[opcode]++;
+	operands.push_back(pack(operand1));
+	operands.push_back(pack(operand2));
+}
+
+void program::set_live_after(vector<register_set>& live) {
+	live_after.swap(live);
+}
+
+void program::set_frame_plans(vector<frame_plan>& plans) {
+	frame_plans.swap(plans);
+	frames_analyzed = true;
+}
+
+void program::set_address_uses(vector<address_use>& uses) {
+	address_uses.swap(uses);
+}
+
+packed_operand program::pack(const operand_desc& operand) {
+	packed_operand packed;
+	packed.kind = operand.kind;
+	packed.base = operand.base;
+	packed.index = operand.index;
+	packed.scale = operand.scale;
+	packed.value = operand.kind == OPERAND_IMMEDIATE ? operand.immediate : operand.displacement;
+	packed.text_offset = operand.text.empty() ? 0 : operand.text.data() - strings;
+	packed.text_size = operand.text.size();
+	packed.value_size = operand.value_text.size();
+	return packed;
+}
+
+size_t program::instruction_count() const {
+	return opcodes.size();
+}
+
+size_t program::opcode_count(opcode_id opcode) const {
+	return opcode_counts[opcode];
+}
+
+size_t program::block_count() const {
+	return block_first.size();
+}
+
+opcode_id program::get_opcode(uint32_t i) const {
+	return (opcode_id) opcodes[i];
+}
+
+operand_desc program::get_operand(uint32_t i, int n) const {
+	const packed_operand& packed = operands[2 * i + n];
+	operand_desc operand;
+	operand.kind = (operand_kind) packed.kind;
+	operand.base = (register_id) packed.base;
+	operand.index = (register_id) packed.index;
+	operand.scale = packed.scale;
+	operand.displacement = operand.kind == OPERAND_IMMEDIATE ? 0 : packed.value;
+	operand.immediate = operand.kind == OPERAND_IMMEDIATE ? packed.value : 0;
+	operand.text = text_ref(strings + packed.text_offset, packed.text_size);
+	operand.value_text = text_ref(operand.text.begin() + (operand.kind == OPERAND_IMMEDIATE ? 1 : 0), packed.value_size);
+	return operand;
+}
+
+text_ref program::get_block_label(uint32_t b) const {
+	return text_ref(strings + label_offsets[b], label_sizes[b]);
+}
+
+uint32_t program::get_block_line(uint32_t b) const {
+	return label_lines[b];
+}
+
+uint32_t program::get_block_first(uint32_t b) const {
+	return block_first[b];
+}
+
+uint32_t program::get_block_last(uint32_t b) const {
+	return b + 1 < block_first.size() ? block_first[b + 1] : opcodes.size();
+}
+
+bool program::has_liveness() const {
+	return !live_after.empty() || opcodes.empty();
+}
+
+register_set program::get_live_after(uint32_t i) const {
+	return i < live_after.size() ? live_after[i] : (register_set) ~0;
+}
+
+bool program::has_frame_plans() const {
+	return frames_analyzed;
+}
+
+const frame_plan* program::get_frame_plan(uint32_t i) const {
+	// the last plan starting at or before i
+	size_t low = 0, high = frame_plans.size();
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		if (frame_plans[middle].first_instruction <= i) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == 0 || frame_plans[low - 1].last_instruction < i) {
+		return NULL;
+	}
+	return &frame_plans[low - 1];
+}
+
+bool program::has_address_uses() const {
+	return !address_uses.empty() || opcodes.empty();
+}
+
+address_use program::get_address_use(uint32_t i) const {
+	return i < address_uses.size() ? address_uses[i] : address_use{0, true};
+}
+
+const promoted_slot* frame_plan::find(int32_t displacement) const {
+	for (auto slot = slots.begin(); slot != slots.end(); slot++) {
+		if (slot->displacement == displacement) {
+			return &*slot;
+		}
+	}
+	return NULL;
+}
+
+index_range<block> program::get_blocks() const {
+	return index_range<block>(this, 0, block_first.size());
+}
+
+index_range<instruction> program::get_instructions(uint32_t first, uint32_t last) const {
+	return index_range<instruction>(this, first, last);
+}
+
+program::~program() {
+	if (mapped_text != NULL) {
+		munmap(mapped_text, mapped_size);
+	}
+}
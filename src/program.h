@@ -0,0 +1,137 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "text_ref.h"
+#include "opcode.h"
+#include "operand.h"
+#include "index_range.h"
+#include "block.h"
+#include "instruction.h"
+
+using namespace std;
+
+// fixed size form of operand_desc; texts are offsets into the string table,
+// so the string table may move while the program is being built. The parser
+// rejects input that does not fit, see program::MAX_TEXT_SIZE
+struct packed_operand {
+	uint8_t kind;
+	uint8_t base;
+	uint8_t index;
+	uint8_t scale;
+	int32_t value;        // immediate, displacement or absolute address
+	uint32_t text_offset;
+	uint16_t text_size;
+	uint16_t value_size;  // value_text starts at text, or right after the '$'
+};
+
+// a frame slot kept in a register for the whole of its procedure, see promotion.h
+struct promoted_slot {
+	int32_t displacement; // from %ebp
+	uint8_t reg;          // index into the promotion registers, the callee-saved ones first
+	bool argument;        // an argument the procedure only reads, loaded on entry
+};
+
+// the promoted slots of one procedure
+struct frame_plan {
+	uint32_t first_instruction;
+	uint32_t last_instruction;
+	uint32_t setup_instruction; // the frame's movl %esp, %ebp or subl $n, %esp
+	int32_t frame_size;         // the n of subl $n, %esp, 0 without
+	vector<promoted_slot> slots;
+
+	// NULL when the slot at displacement stays in memory
+	const promoted_slot* find(int32_t displacement) const;
+};
+
+// where the translation of an instruction finds the address of its indexed
+// or scaled indexed memory operand, see addressing.h
+struct address_use {
+	uint8_t reg;   // index into the address registers, $s6 first
+	bool computed; // false when reg still holds the address from an earlier instruction
+};
+
+// a parsed program, stored as parallel arrays: one opcode and two operands
+// per instruction, and the label and first instruction of each block. All
+// text lives in one string table, the input itself, which the program owns
+// (as a private file mapping or an owned buffer) and releases on destruction
+class program {
+private:
+	char* mapped_text;
+	size_t mapped_size;
+	string owned_text;
+	const char* strings;
+
+	vector<uint8_t> opcodes;
+	vector<packed_operand> operands;
+	vector<uint32_t> block_first;
+	vector<uint32_t> label_offsets;
+	vector<uint32_t> label_sizes;
+	vector<uint32_t> label_lines;   // line number of each label in the input, 0 for none
+	vector<uint32_t> opcode_counts; // instructions of each opcode
+	vector<register_set> live_after; // per instruction, empty until analyzed
+	vector<frame_plan> frame_plans;  // by first instruction, only those promoting a slot
+	bool frames_analyzed;
+	vector<address_use> address_uses; // per instruction, empty until analyzed
+
+	packed_operand pack(const operand_desc& operand);
+
+public:
+	// what the packed fields hold: text offsets are 32 bits, operand texts
+	// 16 and the scale 8
+	static const uint64_t MAX_TEXT_SIZE = 0xffffffffu; // bytes of input
+	static const size_t MAX_OPERAND_SIZE = 0xffff;
+	static const int MAX_SCALE = 0xff;
+
+	program();
+	program(const program&) = delete;
+	program& operator=(const program&) = delete;
+
+	/** building **/
+	void adopt_mapping(char* text, size_t size);
+	string& get_owned_text();
+	// texts passed to add_* must point into the string table, which is the
+	// mapping or owned_text at the time of the call
+	void use_mapping();
+	void use_owned_text();
+	void reserve(size_t instruction_count);
+	// drops every block, instruction and text, keeping the memory for reuse
+	void clear();
+	void add_block(text_ref label, uint32_t line = 0);
+	void add_instruction(opcode_id opcode, const operand_desc& operand1, const operand_desc& operand2);
+	// the registers live after each instruction, from liveness; taken over
+	void set_live_after(vector<register_set>& live);
+	// the procedures with promoted frame slots, from frame_promotion; taken over
+	void set_frame_plans(vector<frame_plan>& plans);
+	// the address registers of each instruction, from address_reuse; taken over
+	void set_address_uses(vector<address_use>& uses);
+
+	/** access **/
+	size_t instruction_count() const;
+	size_t opcode_count(opcode_id opcode) const;
+	size_t block_count() const;
+	opcode_id get_opcode(uint32_t i) const;
+	operand_desc get_operand(uint32_t i, int n) const;
+	text_ref get_block_label(uint32_t b) const;
+	uint32_t get_block_line(uint32_t b) const;
+	uint32_t get_block_first(uint32_t b) const;
+	uint32_t get_block_last(uint32_t b) const;
+	bool has_liveness() const;
+	// every register until liveness has been set
+	register_set get_live_after(uint32_t i) const;
+	bool has_frame_plans() const;
+	// the plan of the procedure instruction i belongs to, NULL when it promotes nothing
+	const frame_plan* get_frame_plan(uint32_t i) const;
+	bool has_address_uses() const;
+	// $s6, computed, until the address uses have been set
+	address_use get_address_use(uint32_t i) const;
+
+	index_range<block> get_blocks() const;
+	index_range<instruction> get_instructions(uint32_t first, uint32_t last) const;
+
+	~program();
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "promotion.h"
+#include <algorithm>
+#include "strength.h"
+
+static const int ACCESS_READ = 1;
+static const int ACCESS_WRITE = 2;
+static const int ACCESS_UNSUPPORTED = 4;
+
+// a loop weighs this much more than the code around it, up to MAX_LOOP_DEPTH loops
+static const uint64_t LOOP_WEIGHT = 8;
+static const int MAX_LOOP_DEPTH = 6;
+
+// how instruction i uses the d(%ebp) slot in operand n, as the translator's
+// promoted forms can take it
+static int slot_access(const program& prog, uint32_t i, int n) {
+	operand_desc other = prog.get_operand(i, 1 - n);
+	bool other_simple = other.kind == OPERAND_REGISTER || other.kind == OPERAND_IMMEDIATE;
+	switch (prog.get_opcode(i)) {
+		case OP_MOVL:
+			if (n == 0 && other.kind == OPERAND_REGISTER) {
+				return ACCESS_READ;
+			}
+			return n == 1 && other_simple ? ACCESS_WRITE : ACCESS_UNSUPPORTED;
+		case OP_ADDL: case OP_ANDL: case OP_XORL: case OP_ORL:
+			if (n == 0 && other.kind == OPERAND_REGISTER) {
+				return ACCESS_READ;
+			}
+			return n == 1 && other.kind == OPERAND_IMMEDIATE ? ACCESS_READ | ACCESS_WRITE : ACCESS_UNSUPPORTED;
+		case OP_DECL:
+			return ACCESS_READ | ACCESS_WRITE;
+		case OP_CMPL:
+			return other_simple ? ACCESS_READ : ACCESS_UNSUPPORTED;
+		default:
+			return ACCESS_UNSUPPORTED;
+	}
+}
+
+static bool is_register(const operand_desc& operand, register_id reg) {
+	return operand.kind == OPERAND_REGISTER && operand.base == reg;
+}
+
+// addl $n, %esp right before a leave, freeing the n bytes of locals the
+// frame setup allocated, which the translation of leave alone does not
+static bool is_deallocation(const program& prog, uint32_t i, uint32_t block_end, int32_t frame_size) {
+	operand_desc amount = prog.get_operand(i, 0);
+	return frame_size > 0 && prog.get_opcode(i) == OP_ADDL && i + 1 < block_end && prog.get_opcode(i + 1) == OP_LEAVE
+		&& amount.kind == OPERAND_IMMEDIATE && is_number(amount.value_text) && amount.immediate == frame_size
+		&& is_register(prog.get_operand(i, 1), REG_ESP);
+}
+
+frame_promotion::frame_promotion(const program& prog, const control_flow_graph& cfg,
+		const unordered_map<string, int>& label_dic) : prog(prog), cfg(cfg), label_dic(label_dic) {
+	split_procedures();
+	check_entries();
+	weigh_loops();
+}
+
+// as the translator splits them: a procedure starts at the first label
+// after a block with a leave
+void frame_promotion::split_procedures() {
+	bool is_procedure_head = true;
+	procedure_of.resize(prog.block_count());
+	for (uint32_t b = 0; b < prog.block_count(); b++) {
+		if (b == 0 || (is_procedure_head && !prog.get_block_label(b).empty())) {
+			procedure_first.push_back(b);
+			is_procedure_head = false;
+		}
+		procedure_of[b] = procedure_first.size() - 1;
+		for (uint32_t i = prog.get_block_first(b); i < prog.get_block_last(b); i++) {
+			if (prog.get_opcode(i) == OP_LEAVE) {
+				is_procedure_head = true;
+			}
+		}
+	}
+	qualifies.assign(procedure_first.size(), true);
+}
+
+// a jump between procedures, to a label outside the program, or a call
+// into the middle of a procedure runs code under another frame than its own
+void frame_promotion::check_entries() {
+	for (uint32_t b = 0; b < prog.block_count(); b++) {
+		for (uint32_t i = prog.get_block_first(b); i < prog.get_block_last(b); i++) {
+			opcode_id op = prog.get_opcode(i);
+			if (op == OP_JMP || is_conditional_jump(op)) {
+				int32_t target = cfg.get_jump_target(i);
+				if (target < 0) {
+					qualifies[procedure_of[b]] = false;
+				} else if (procedure_of[target] != procedure_of[b]) {
+					qualifies[procedure_of[b]] = false;
+					qualifies[procedure_of[target]] = false;
+				}
+			} else if (op == OP_CALL) {
+				auto target = label_dic.find(prog.get_operand(i, 0).text.str());
+				if (target != label_dic.end() && procedure_first[procedure_of[target->second]] != (uint32_t) target->second) {
+					qualifies[procedure_of[target->second]] = false;
+				}
+			}
+		}
+	}
+}
+
+// a backward jump within a procedure closes a loop over the blocks from its
+// target to itself
+void frame_promotion::weigh_loops() {
+	vector<int> depth(prog.block_count(), 0);
+	for (uint32_t b = 0; b < prog.block_count(); b++) {
+		for (uint32_t i = prog.get_block_first(b); i < prog.get_block_last(b); i++) {
+			int32_t target = cfg.get_jump_target(i);
+			if (target >= 0 && (uint32_t) target <= b && procedure_of[target] == procedure_of[b]) {
+				for (uint32_t loop_block = target; loop_block <= b; loop_block++) {
+					depth[loop_block]++;
+				}
+			}
+		}
+	}
+	block_weights.resize(prog.block_count());
+	for (uint32_t b = 0; b < prog.block_count(); b++) {
+		uint64_t weight = 1;
+		for (int d = 0; d < min(depth[b], MAX_LOOP_DEPTH); d++) {
+			weight *= LOOP_WEIGHT;
+		}
+		block_weights[b] = weight;
+	}
+}
+
+bool frame_promotion::plan_procedure(uint32_t p, frame_plan& plan) {
+	uint32_t first_block = procedure_first[p];
+	uint32_t last_block = p + 1 < procedure_first.size() ? procedure_first[p + 1] - 1 : prog.block_count() - 1;
+	uint32_t first = prog.get_block_first(first_block), end = prog.get_block_last(last_block);
+
+	// the frame setup, and the locals it allocates
+	if (end - first < 2 || prog.get_opcode(first) != OP_PUSHL || !is_register(prog.get_operand(first, 0), REG_EBP)
+			|| prog.get_opcode(first + 1) != OP_MOVL || !is_register(prog.get_operand(first + 1, 0), REG_ESP)
+			|| !is_register(prog.get_operand(first + 1, 1), REG_EBP)) {
+		return false;
+	}
+	uint32_t setup = first + 1;
+	int32_t frame_size = 0;
+	if (first + 2 < end && prog.get_opcode(first + 2) == OP_SUBL) {
+		operand_desc allocation = prog.get_operand(first + 2, 0);
+		if (allocation.kind == OPERAND_IMMEDIATE && is_number(allocation.value_text) && allocation.immediate > 0
+				&& is_register(prog.get_operand(first + 2, 1), REG_ESP)) {
+			setup = first + 2;
+			frame_size = allocation.immediate;
+		}
+	}
+
+	vector<slot_use> uses;
+	bool locals_safe = frame_size > 0;
+	int32_t stack = -frame_size; // %esp from %ebp, along the code in order
+	uint64_t call_weight = 0;
+	int leave_count = 0;
+	for (uint32_t b = first_block; b <= last_block; b++) {
+		uint64_t weight = block_weights[b];
+		for (uint32_t i = max(prog.get_block_first(b), setup + 1); i < prog.get_block_last(b); i++) {
+			if (is_deallocation(prog, i, prog.get_block_last(b), frame_size)) {
+				continue;
+			}
+			for (int n = 0; n < 2; n++) {
+				operand_desc operand = prog.get_operand(i, n);
+				if (operand.kind == OPERAND_REGISTER && (operand.base == REG_EBP || operand.base == REG_ESP)) {
+					return false;
+				}
+				if (!operand.is_memory()) {
+					continue;
+				}
+				if (operand.base == REG_ESP || operand.index == REG_ESP) {
+					return false;
+				}
+				if (operand.base != REG_EBP && operand.index != REG_EBP) {
+					continue;
+				}
+				int32_t d = operand.displacement;
+				if (operand.kind != OPERAND_INDIRECT || operand.base != REG_EBP || !is_number(operand.value_text)
+						|| d % 4 != 0 || (d >= 0 && d < 8)) {
+					return false;
+				}
+				auto use = find_if(uses.begin(), uses.end(), [d](const slot_use& u) { return u.displacement == d; });
+				if (use == uses.end()) {
+					uses.push_back({d, 0, false, true});
+					use = uses.end() - 1;
+				}
+				int access = slot_access(prog, i, n);
+				use->weight += weight;
+				use->written |= (access & ACCESS_WRITE) != 0;
+				use->supported &= (access & ACCESS_UNSUPPORTED) == 0;
+			}
+
+			opcode_id op = prog.get_opcode(i);
+			if (op == OP_PUSHL) {
+				// the arguments of a call in the same block are popped with it
+				uint32_t j = i, block_end = prog.get_block_last(b);
+				while (j < block_end && prog.get_opcode(j) == OP_PUSHL) {
+					j++;
+				}
+				if (j == block_end || prog.get_opcode(j) != OP_CALL) {
+					stack -= 4;
+				}
+			} else if (op == OP_POPL) {
+				stack += 4;
+				locals_safe &= stack <= -frame_size;
+			} else if (op == OP_CALL) {
+				call_weight += weight;
+			} else if (op == OP_LEAVE) {
+				leave_count++;
+				stack = -frame_size;
+			}
+		}
+	}
+
+	sort(uses.begin(), uses.end(), [](const slot_use& a, const slot_use& b) {
+		return a.weight != b.weight ? a.weight > b.weight : a.displacement < b.displacement;
+	});
+	int next_saved = 0, next_temporary = SAVED_REGISTERS;
+	for (auto use = uses.begin(); use != uses.end(); use++) {
+		bool argument = use->displacement >= 8;
+		if (!use->supported || (argument && use->written)
+				|| (!argument && (!locals_safe || use->displacement < -frame_size))) {
+			continue;
+		}
+		// a saved register costs a store on entry and a load at each leave, a
+		// temporary a load on entry for an argument, and around each call a
+		// load, and a store for a local. An access saves a load or a store,
+		// but a read often turns into a move rather than going away, so the
+		// accesses must outweigh twice that
+		if (!argument && next_saved < SAVED_REGISTERS && use->weight > 2 * (uint64_t) (1 + leave_count)) {
+			plan.slots.push_back({use->displacement, (uint8_t) next_saved++, false});
+		} else if (next_temporary < REGISTER_COUNT && use->weight > 2 * (argument ? 1 + call_weight : 2 * call_weight)) {
+			plan.slots.push_back({use->displacement, (uint8_t) next_temporary++, argument});
+		}
+	}
+	plan.first_instruction = first;
+	plan.last_instruction = end - 1;
+	plan.setup_instruction = setup;
+	plan.frame_size = frame_size;
+	return !plan.slots.empty();
+}
+
+vector<frame_plan> frame_promotion::get_plans() {
+	vector<frame_plan> plans;
+	for (uint32_t p = 0; p < procedure_first.size(); p++) {
+		frame_plan plan;
+		if (qualifies[p] && plan_procedure(p, plan)) {
+			plans.push_back(plan);
+		}
+	}
+	return plans;
+}
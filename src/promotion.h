@@ -0,0 +1,64 @@
+#ifndef PROMOTION_H
+#define PROMOTION_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "program.h"
+#include "cfg.h"
+
+using namespace std;
+
+// Finds the %ebp slots each procedure can keep in the MIPS registers the
+// translation leaves free, for the whole procedure. $s3-$s5 come first:
+// the procedure saves the caller's value in the slot's own memory, which
+// nothing else reads any more, and restores it at leave. Then $t3-$t9,
+// which callees may clobber, so locals are stored before each call and
+// loaded again after it.
+//
+// A procedure qualifies when it opens with pushl %ebp and movl %esp, %ebp,
+// uses %ebp only as the base of d(%ebp) with a constant d, never uses %esp
+// as an operand or base other than in an addl $n, %esp freeing the locals
+// right before a leave, and no jump or call enters it other than at its
+// first label; then no slot's address can have escaped. Locals must lie
+// within the subl $n, %esp right after the frame setup, and no popl may
+// reach back into them. Arguments must only be read.
+// Slots are ranked by their accesses, weighted by 8 for each loop around
+// them, and promoted when that is more than twice the saves, loads and
+// spills they cost
+class frame_promotion {
+public:
+	static const int SAVED_REGISTERS = 3;  // $s3-$s5
+	static const int REGISTER_COUNT = 10;  // then $t3-$t9
+
+private:
+	// the accesses of one procedure to one slot
+	struct slot_use {
+		int32_t displacement;
+		uint64_t weight;
+		bool written;
+		bool supported; // every access has a promoted form
+	};
+
+	const program& prog;
+	const control_flow_graph& cfg;
+	const unordered_map<string, int>& label_dic;
+	vector<uint32_t> procedure_of;  // per block, the index of its procedure
+	vector<uint32_t> procedure_first; // first block of each procedure
+	vector<bool> qualifies;         // per procedure, so far
+	vector<uint64_t> block_weights;
+
+	void split_procedures();
+	void check_entries();
+	void weigh_loops();
+	bool plan_procedure(uint32_t p, frame_plan& plan);
+
+public:
+	frame_promotion(const program& prog, const control_flow_graph& cfg, const unordered_map<string, int>& label_dic);
+
+	// the plans of the procedures promoting at least one slot, by first
+	// instruction, for program::set_frame_plans
+	vector<frame_plan> get_plans();
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "scanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCANNER_X86
+#include <immintrin.h>
+#endif
+
+/** kernels **/
+
+// also scans the last block of a buffer, which may be shorter
+static void scan_bytes(char* block, size_t size, scan_masks& masks) {
+	masks.newline = masks.comment = masks.colon = 0;
+	for (size_t i = 0; i < size; i++) {
+		char c = block[i];
+		if (c >= 'A' && c <= 'Z') {
+			block[i] = c - 'A' + 'a';
+		}
+		masks.newline |= (uint64_t) (c == '\n') << i;
+		masks.comment |= (uint64_t) (c == '#') << i;
+		masks.colon |= (uint64_t) (c == ':') << i;
+	}
+}
+
+static void scan_scalar(char* block, scan_masks& masks) {
+	scan_bytes(block, 64, masks);
+}
+
+#ifdef SCANNER_X86
+// bytes are compared as signed, so those from 0x80 up are never upper case.
+// Only blocks with upper case are written back: a page of a private mapping
+// is copied on its first write
+__attribute__((target("sse2")))
+static void scan_sse2(char* block, scan_masks& masks) {
+	const __m128i newline = _mm_set1_epi8('\n'), comment = _mm_set1_epi8('#'), colon = _mm_set1_epi8(':');
+	const __m128i before_a = _mm_set1_epi8('A' - 1), after_z = _mm_set1_epi8('Z' + 1), case_bit = _mm_set1_epi8(0x20);
+	masks.newline = masks.comment = masks.colon = 0;
+	for (int i = 0; i < 64; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*) (block + i));
+		masks.newline |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << i;
+		masks.comment |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, comment)) << i;
+		masks.colon |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, colon)) << i;
+		__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_a), _mm_cmpgt_epi8(after_z, v));
+		if (_mm_movemask_epi8(upper) != 0) {
+			_mm_storeu_si128((__m128i*) (block + i), _mm_or_si128(v, _mm_and_si128(upper, case_bit)));
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static void scan_avx2(char* block, scan_masks& masks) {
+	const __m256i newline = _mm256_set1_epi8('\n'), comment = _mm256_set1_epi8('#'), colon = _mm256_set1_epi8(':');
+	const __m256i before_a = _mm256_set1_epi8('A' - 1), after_z = _mm256_set1_epi8('Z' + 1), case_bit = _mm256_set1_epi8(0x20);
+	masks.newline = masks.comment = masks.colon = 0;
+	for (int i = 0; i < 64; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*) (block + i));
+		masks.newline |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)) << i;
+		masks.comment |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, comment)) << i;
+		masks.colon |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, colon)) << i;
+		__m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, before_a), _mm256_cmpgt_epi8(after_z, v));
+		if (_mm256_movemask_epi8(upper) != 0) {
+			_mm256_storeu_si256((__m256i*) (block + i), _mm256_or_si256(v, _mm256_and_si256(upper, case_bit)));
+		}
+	}
+}
+#endif
+
+struct kernel_choice {
+	scan_kernel kernel;
+	const char* name;
+};
+
+static kernel_choice choose_kernel() {
+#ifdef SCANNER_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return {scan_avx2, "avx2"};
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return {scan_sse2, "sse2"};
+	}
+#endif
+	return {scan_scalar, "scalar"};
+}
+
+// chosen on first use
+static const kernel_choice& selected_kernel() {
+	static const kernel_choice choice = choose_kernel();
+	return choice;
+}
+
+const char* line_scanner::kernel_name() {
+	return selected_kernel().name;
+}
+
+/** line splitting **/
+
+line_scanner::line_scanner(char* begin, char* end) : pos(begin), end(end), block(begin) {
+	if (begin < end) {
+		scan_block();
+	}
+}
+
+// the kernels read whole blocks, so a shorter last block (and a line read
+// on its own) is scanned a byte at a time
+void line_scanner::scan_block() {
+	size_t size = end - block;
+	if (size >= BLOCK_SIZE) {
+		selected_kernel().kernel(block, masks);
+	} else {
+		scan_bytes(block, size, masks);
+	}
+}
+
+bool line_scanner::next(scanned_line& line) {
+	if (pos >= end) {
+		return false;
+	}
+	line.begin = pos;
+	line.code_end = NULL;
+	line.colon = NULL;
+	while (true) {
+		if (pos >= end) {
+			line.end = end;
+			break;
+		}
+		if (pos >= block + BLOCK_SIZE) {
+			block += BLOCK_SIZE;
+			scan_block();
+		}
+		// the classes still looked for, from pos on
+		uint64_t wanted = masks.newline;
+		if (line.code_end == NULL) {
+			wanted |= masks.comment;
+			if (line.colon == NULL) {
+				wanted |= masks.colon;
+			}
+		}
+		wanted &= ~0ULL << (pos - block);
+		if (wanted == 0) {
+			pos = block + BLOCK_SIZE;
+			continue;
+		}
+		int i = __builtin_ctzll(wanted);
+		pos = block + i + 1;
+		if (masks.newline >> i & 1) {
+			line.end = block + i;
+			break;
+		} else if (masks.comment >> i & 1) {
+			line.code_end = block + i;
+		} else {
+			line.colon = block + i;
+		}
+	}
+	if (line.code_end == NULL) {
+		line.code_end = line.end;
+	}
+	return true;
+}
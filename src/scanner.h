@@ -0,0 +1,53 @@
+#ifndef SCANNER_H
+#define SCANNER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+// one line of the input, lowercased up to its comment
+struct scanned_line {
+	char* begin;
+	char* end;      // the newline, or the end of the input
+	char* code_end; // the '#' starting the comment, end when there is none
+	char* colon;    // the first ':' before code_end, NULL when there is none
+};
+
+// bit i is set when byte i of a 64 byte block is of the class
+struct scan_masks {
+	uint64_t newline;
+	uint64_t comment;
+	uint64_t colon;
+};
+
+// classifies a 64 byte block and lowercases it in place
+typedef void (*scan_kernel)(char* block, scan_masks& masks);
+
+// splits a buffer into lines 64 bytes at a time, lowercasing it on the way.
+// The kernel uses AVX2 or SSE2 when the CPU has them, chosen once at run
+// time, and a byte at a time otherwise
+class line_scanner {
+private:
+	static const size_t BLOCK_SIZE = 64;
+
+	char* pos;   // start of the next line
+	char* end;
+	char* block; // the block masks is for
+	scan_masks masks;
+
+	void scan_block();
+
+public:
+	// the buffer is modified and must outlive the lines
+	line_scanner(char* begin, char* end);
+
+	// the next line, false when the buffer is used up. A newline ending the
+	// buffer does not start another line
+	bool next(scanned_line& line);
+
+	// "avx2", "sse2" or "scalar"
+	static const char* kernel_name();
+};
+
+#endif
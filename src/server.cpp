@@ -0,0 +1,375 @@
+#include "server.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_set>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "parser.h"
+#include "thread_pool.h"
+
+// larger bodies are refused, they are more likely a client speaking
+// another protocol than a real input
+static const uint32_t MAX_BODY_SIZE = 1u << 30;
+
+/** latency **/
+
+void latency_recorder::add(double seconds) {
+	lock_guard<mutex> guard(lock);
+	micros.push_back((uint32_t) min(seconds * 1e6, 4e9));
+}
+
+void latency_recorder::report(ostream& os) {
+	vector<uint32_t> sorted;
+	{
+		lock_guard<mutex> guard(lock);
+		sorted = micros;
+	}
+	os << "requests: " << sorted.size() << endl;
+	if (sorted.empty()) {
+		return;
+	}
+	sort(sorted.begin(), sorted.end());
+	const int percentiles[] = {50, 90, 99};
+	os << "latency (us):";
+	for (int p : percentiles) {
+		// nearest rank
+		size_t rank = (sorted.size() * p + 99) / 100;
+		os << " p" << p << " " << sorted[max(rank, (size_t) 1) - 1];
+	}
+	os << ", max " << sorted.back() << endl;
+}
+
+/** messages **/
+
+// false on end of input or an error before size bytes were read
+static bool read_fully(int fd, void* data, size_t size) {
+	char* p = (char*) data;
+	while (size > 0) {
+		ssize_t n = read(fd, p, size);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+// MSG_NOSIGNAL: a peer that went away is an error here, not a SIGPIPE
+static bool write_fully(int fd, const void* data, size_t size) {
+	const char* p = (const char*) data;
+	while (size > 0) {
+		ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool read_message(int fd, uint32_t& word, string& body) {
+	uint32_t header[2];
+	if (!read_fully(fd, header, sizeof(header))) {
+		return false;
+	}
+	word = ntohl(header[0]);
+	uint32_t size = ntohl(header[1]);
+	if (size > MAX_BODY_SIZE) {
+		return false;
+	}
+	body.resize(size);
+	return size == 0 || read_fully(fd, &body[0], size);
+}
+
+static bool write_message(int fd, uint32_t word, const string& body) {
+	uint32_t header[2] = {htonl(word), htonl((uint32_t) body.size())};
+	return write_fully(fd, header, sizeof(header)) && write_fully(fd, body.data(), body.size());
+}
+
+static bool socket_address(const string& path, sockaddr_un& address, string& error) {
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+		error = "socket path must be 1 to " + to_string(sizeof(address.sun_path) - 1) + " characters: " + path;
+		return false;
+	}
+	strcpy(address.sun_path, path.c_str());
+	return true;
+}
+
+// -1 with error when nothing listens on path
+static int connect_socket(const string& path, string& error) {
+	sockaddr_un address;
+	if (!socket_address(path, address, error)) {
+		return -1;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		error = string("cannot create a socket: ") + strerror(errno);
+		return -1;
+	}
+	if (connect(fd, (sockaddr*) &address, sizeof(address)) != 0) {
+		error = "cannot connect to " + path + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/** server **/
+
+struct server_state {
+	translator& engine;
+	int listen_fd;
+	latency_recorder latency;
+	atomic<bool> stopping;
+	mutex connections_lock;
+	unordered_set<int> connections; // open, so stopping can wake the workers reading them
+
+	server_state(translator& engine, int listen_fd) : engine(engine), listen_fd(listen_fd), stopping(false) {}
+};
+
+// requests are answered in turn until the client closes the connection
+static void serve_connection(server_state& state, int fd, parser& input) {
+	uint32_t kind;
+	string body;
+	while (read_message(fd, kind, body)) {
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		uint32_t status = REPLY_OK;
+		ostringstream reply;
+		if (kind == REQUEST_TRANSLATE) {
+			try {
+				input.load(body.data(), body.size());
+				state.engine.translate_IA32_to_MIPS(input, reply);
+			} catch (const exception& e) {
+				status = REPLY_ERROR;
+				reply.str(e.what());
+			}
+		} else if (kind == REQUEST_REPORT) {
+			state.latency.report(reply);
+		} else if (kind != REQUEST_SHUTDOWN) {
+			status = REPLY_ERROR;
+			reply << "unknown request kind " << kind;
+		}
+		bool written = write_message(fd, status, reply.str());
+		if (kind == REQUEST_TRANSLATE) {
+			state.latency.add(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+		}
+		if (kind == REQUEST_SHUTDOWN) {
+			kill(getpid(), SIGTERM); // taken by run_server's sigwait
+		}
+		if (!written) {
+			return;
+		}
+	}
+}
+
+// each worker keeps its own parser, whose memory is reused from one request to the next
+static void serve(server_state& state) {
+	parser input("", 0);
+	while (true) {
+		int fd = accept(state.listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED) {
+				continue;
+			}
+			return; // the listening socket was shut down
+		}
+		{
+			lock_guard<mutex> guard(state.connections_lock);
+			if (state.stopping) {
+				close(fd);
+				return;
+			}
+			state.connections.insert(fd);
+		}
+		serve_connection(state, fd, input);
+		{
+			lock_guard<mutex> guard(state.connections_lock);
+			state.connections.erase(fd);
+		}
+		close(fd);
+	}
+}
+
+// a socket file that nobody listens on is left over from a server that
+// died, and is replaced
+static int listen_socket(const string& path, string& error) {
+	sockaddr_un address;
+	if (!socket_address(path, address, error)) {
+		return -1;
+	}
+	string connect_error;
+	int existing = connect_socket(path, connect_error);
+	if (existing >= 0) {
+		close(existing);
+		error = "a server is already listening on " + path;
+		return -1;
+	}
+	unlink(path.c_str());
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		error = string("cannot create a socket: ") + strerror(errno);
+		return -1;
+	}
+	if (bind(fd, (sockaddr*) &address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+		error = "cannot listen on " + path + ": " + strerror(errno);
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+// translate_IA32_to_MIPS leaves the translator untouched, one serves all workers
+bool run_server(translator& translator, const string& socket_path, size_t thread_count, string& error) {
+	// blocked before the workers start, so they inherit the mask and the
+	// signals wait for the sigwait below
+	sigset_t stop_signals, previous;
+	sigemptyset(&stop_signals);
+	sigaddset(&stop_signals, SIGINT);
+	sigaddset(&stop_signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+
+	int listen_fd = listen_socket(socket_path, error);
+	if (listen_fd < 0) {
+		pthread_sigmask(SIG_SETMASK, &previous, NULL);
+		return false;
+	}
+	server_state state(translator, listen_fd);
+	{
+		thread_pool pool(thread_count);
+		for (size_t i = 0; i < pool.size(); i++) {
+			pool.submit([&state] { serve(state); });
+		}
+		cerr << "serving on " << socket_path << " with " << pool.size() << " workers" << endl;
+
+		int signal_number;
+		sigwait(&stop_signals, &signal_number);
+
+		// wakes the workers waiting in accept and in reads of idle connections;
+		// a request being translated is still answered
+		{
+			lock_guard<mutex> guard(state.connections_lock);
+			state.stopping = true;
+			shutdown(listen_fd, SHUT_RDWR);
+			for (int fd : state.connections) {
+				shutdown(fd, SHUT_RD);
+			}
+		}
+		pool.wait();
+	}
+	close(listen_fd);
+	unlink(socket_path.c_str());
+	pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+	state.latency.report(cerr);
+	return true;
+}
+
+/** client **/
+
+static bool read_file(const string& path, string& contents) {
+	ifstream in(path, ios::binary);
+	if (!in) {
+		return false;
+	}
+	stringstream buffer;
+	buffer << in.rdbuf();
+	contents = buffer.str();
+	return true;
+}
+
+// false with error when the connection fails, which ends the run
+static bool exchange(int fd, uint32_t kind, const string& body, uint32_t& status, string& reply, string& error) {
+	if (!write_message(fd, kind, body) || !read_message(fd, status, reply)) {
+		error = "connection to the server lost";
+		return false;
+	}
+	return true;
+}
+
+int run_client(const string& socket_path, const vector<batch_job>& jobs, bool binary) {
+	string error;
+	int fd = connect_socket(socket_path, error);
+	if (fd < 0) {
+		cerr << "Error: " << error << endl;
+		return -1;
+	}
+
+	int failures = 0;
+	string input, reply;
+	for (auto job = jobs.begin(); job != jobs.end(); job++) {
+		if (!read_file(job->input_path, input)) {
+			cerr << "Error: cannot read " << job->input_path << endl;
+			failures++;
+			continue;
+		}
+		uint32_t status;
+		if (!exchange(fd, REQUEST_TRANSLATE, input, status, reply, error)) {
+			cerr << "Error: " << error << endl;
+			close(fd);
+			return failures + (jobs.end() - job);
+		}
+		if (status != REPLY_OK) {
+			cerr << "Error: " << job->input_path << ": " << reply << endl;
+			failures++;
+			continue;
+		}
+
+		if (binary) {
+			if (!write_binary(reply, job->output_path, error)) {
+				cerr << "Error: " << error << endl;
+				failures++;
+			}
+			continue;
+		}
+		ofstream os(job->output_path, ios::binary);
+		os.write(reply.data(), reply.size());
+		os.close();
+		if (!os) {
+			cerr << "Error: error writing " << job->output_path << endl;
+			failures++;
+		}
+	}
+	close(fd);
+	return failures;
+}
+
+bool client_request(const string& socket_path, request_kind kind, ostream& os, string& error) {
+	int fd = connect_socket(socket_path, error);
+	if (fd < 0) {
+		return false;
+	}
+	uint32_t status;
+	string reply;
+	bool exchanged = exchange(fd, kind, "", status, reply, error);
+	close(fd);
+	if (!exchanged) {
+		return false;
+	}
+	if (status != REPLY_OK) {
+		error = reply;
+		return false;
+	}
+	os << reply;
+	return true;
+}
@@ -0,0 +1,57 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <ostream>
+#include "translator.h"
+#include "batch.h"
+
+using namespace std;
+
+// The protocol of --serve and --client, over a Unix domain socket. A request
+// is two 32-bit big endian words, its kind and the size of its body, then
+// the body; the reply is the status and the size of its body the same way,
+// then the body. A connection carries any number of requests in turn
+enum request_kind {
+	REQUEST_TRANSLATE = 0, // body: IA32 source, reply: its MIPS
+	REQUEST_REPORT = 1,    // no body, reply: the server's latency report
+	REQUEST_SHUTDOWN = 2   // no body, the server stops once the reply is sent
+};
+
+enum reply_status {
+	REPLY_OK = 0,
+	REPLY_ERROR = 1 // body: what went wrong
+};
+
+// the time each request took, from its header being read to its reply
+// being written, reported as percentiles
+class latency_recorder {
+private:
+	mutex lock;
+	vector<uint32_t> micros;
+
+public:
+	void add(double seconds);
+	// the request count and the 50th, 90th, 99th percentile and maximum
+	void report(ostream& os);
+};
+
+// translates the requests of clients connecting to socket_path with the
+// one translator, one connection at a time on each of thread_count workers
+// (one per core for 0). Runs until a shutdown request, SIGINT or SIGTERM,
+// then writes its latency report to stderr. False when the socket cannot be
+// set up, or another server is already listening on it
+bool run_server(translator& translator, const string& socket_path, size_t thread_count, string& error);
+
+// sends each job's input to the server at socket_path over one connection
+// and writes the reply to the job's output, as machine code with binary.
+// Reports each failure on stderr and returns the number of failed jobs, or
+// -1 when the server cannot be reached
+int run_client(const string& socket_path, const vector<batch_job>& jobs, bool binary);
+// a request without a body; the reply is written to os
+bool client_request(const string& socket_path, request_kind kind, ostream& os, string& error);
+
+#endif
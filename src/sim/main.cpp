@@ -0,0 +1,84 @@
+// Runs a translated program and reports what it executed and what that
+// would cost, for comparing translations offline:
+//     mips_sim [--max-instructions n] [--quiet] program.s
+//     mips_sim [--max-instructions n] [--quiet] --binary program
+// The second form runs program.text, program.data and program.sym as the
+// translator writes them with --binary.
+// The program's output goes to stdout, the report to stderr.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string.h>
+#include <stdlib.h>
+#include "simulator.h"
+
+using namespace std;
+
+static bool read_file(const string& path, string& contents) {
+	ifstream in(path, ios::binary);
+	if (!in) {
+		return false;
+	}
+	stringstream buffer;
+	buffer << in.rdbuf();
+	contents = buffer.str();
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	uint64_t max_instructions = 1000000000;
+	bool quiet = false;
+	bool binary = false;
+	const char* path = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--max-instructions") == 0 && i + 1 < argc) {
+			max_instructions = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--quiet") == 0) {
+			quiet = true;
+		} else if (strcmp(argv[i], "--binary") == 0) {
+			binary = true;
+		} else {
+			path = argv[i];
+		}
+	}
+	if (path == NULL) {
+		cout << "Usage: mips_sim [--max-instructions n] [--quiet] program.s" << endl;
+		cout << "       mips_sim [--max-instructions n] [--quiet] --binary program" << endl;
+		return -1;
+	}
+
+	mips_simulator simulator;
+	string error;
+	if (binary) {
+		string images[3];
+		const char* suffixes[3] = {".text", ".data", ".sym"};
+		for (int i = 0; i < 3; i++) {
+			if (!read_file(string(path) + suffixes[i], images[i])) {
+				cerr << "Error reading " << path << suffixes[i] << endl;
+				return 1;
+			}
+		}
+		if (!simulator.load_binary(images[0], images[1], images[2], error)) {
+			cerr << path << ": " << error << endl;
+			return 1;
+		}
+	} else {
+		string source;
+		if (!read_file(path, source)) {
+			cerr << "Error reading " << path << endl;
+			return 1;
+		}
+		if (!simulator.load(source, error)) {
+			cerr << path << ": " << error << endl;
+			return 1;
+		}
+	}
+	ostream discarded(NULL); // drops everything written to it
+	sim_report report;
+	if (!simulator.run(quiet ? (ostream&) discarded : cout, max_instructions, report, error)) {
+		cerr << path << ": " << error << endl;
+		return 1;
+	}
+	print_report(report, cerr);
+	return report.exit_code;
+}
@@ -0,0 +1,1017 @@
+#include "simulator.h"
+#include <sstream>
+#include <algorithm>
+#include <iomanip>
+#include <string.h>
+#include <stdlib.h>
+
+static const char* const REGISTER_NAMES[32] = {
+	"zero", "at", "v0", "v1", "a0", "a1", "a2", "a3",
+	"t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7",
+	"s0", "s1", "s2", "s3", "s4", "s5", "s6", "s7",
+	"t8", "t9", "k0", "k1", "gp", "sp", "fp", "ra"
+};
+static const int REG_SP = 29;
+static const int REG_RA = 31;
+static const int BIT_HI = 32;
+static const int BIT_LO = 33;
+
+static uint64_t bit(int r) {
+	return r <= 0 ? 0 : (uint64_t) 1 << r; // $zero never waits for anything
+}
+
+static bool fits_signed16(int64_t value) {
+	return value >= -32768 && value <= 32767;
+}
+
+static bool fits_unsigned16(int64_t value) {
+	return value >= 0 && value <= 65535;
+}
+
+static string trim(const string& text) {
+	size_t begin = text.find_first_not_of(" \t\r");
+	if (begin == string::npos) {
+		return "";
+	}
+	size_t end = text.find_last_not_of(" \t\r");
+	return text.substr(begin, end - begin + 1);
+}
+
+static string line_error(uint32_t line, const string& message) {
+	return "line " + to_string(line) + ": " + message;
+}
+
+static int parse_register(const string& text) {
+	if (text.size() < 2 || text[0] != '$') {
+		return -1;
+	}
+	string name = text.substr(1);
+	if (isdigit((unsigned char) name[0])) {
+		int r = atoi(name.c_str());
+		return r >= 0 && r < 32 ? r : -1;
+	}
+	if (name == "s8") {
+		return 30;
+	}
+	for (int r = 0; r < 32; r++) {
+		if (name == REGISTER_NAMES[r]) {
+			return r;
+		}
+	}
+	return -1;
+}
+
+static bool parse_number(const string& text, int64_t& value) {
+	if (text.empty()) {
+		return false;
+	}
+	const char* begin = text.c_str();
+	if (*begin == '\'' && text.size() == 3 && text[2] == '\'') {
+		value = text[1];
+		return true;
+	}
+	char* end;
+	value = strtoll(begin, &end, 0);
+	return end != begin && *end == '\0';
+}
+
+// the text up to the first comment, commas and # inside quotes are kept
+static string strip_comment(const string& line) {
+	bool quoted = false;
+	for (size_t i = 0; i < line.size(); i++) {
+		if (line[i] == '"' && (i == 0 || line[i - 1] != '\\')) {
+			quoted = !quoted;
+		} else if (line[i] == '#' && !quoted) {
+			return line.substr(0, i);
+		}
+	}
+	return line;
+}
+
+static vector<string> split_operands(const string& text) {
+	vector<string> operands;
+	string current;
+	bool quoted = false;
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '"' && (i == 0 || text[i - 1] != '\\')) {
+			quoted = !quoted;
+		}
+		if (text[i] == ',' && !quoted) {
+			operands.push_back(trim(current));
+			current.clear();
+		} else {
+			current += text[i];
+		}
+	}
+	if (!trim(current).empty() || !operands.empty()) {
+		operands.push_back(trim(current));
+	}
+	return operands;
+}
+
+static bool is_label_char(char c) {
+	return isalnum((unsigned char) c) || c == '_' || c == '.' || c == '$';
+}
+
+/** operand forms **/
+
+// how the operands of each mnemonic are laid out
+enum sim_form { FORM_ALU3, FORM_ALU2, FORM_LI, FORM_LA, FORM_MULDIV, FORM_MOVE_FROM, FORM_MEMORY,
+	FORM_BRANCH, FORM_BRANCH_ZERO, FORM_JUMP, FORM_JR, FORM_JALR, FORM_NONE };
+
+struct sim_mnemonic {
+	const char* name;
+	sim_op op;
+	sim_form form;
+};
+
+static const sim_mnemonic MNEMONICS[] = {
+	{"add", SIM_ADD, FORM_ALU3}, {"addu", SIM_ADD, FORM_ALU3}, {"addi", SIM_ADD, FORM_ALU3}, {"addiu", SIM_ADD, FORM_ALU3},
+	{"sub", SIM_SUB, FORM_ALU3}, {"subu", SIM_SUB, FORM_ALU3},
+	{"and", SIM_AND, FORM_ALU3}, {"andi", SIM_AND, FORM_ALU3},
+	{"or", SIM_OR, FORM_ALU3}, {"ori", SIM_OR, FORM_ALU3},
+	{"xor", SIM_XOR, FORM_ALU3}, {"xori", SIM_XOR, FORM_ALU3},
+	{"nor", SIM_NOR, FORM_ALU3},
+	{"slt", SIM_SLT, FORM_ALU3}, {"slti", SIM_SLT, FORM_ALU3},
+	{"sltu", SIM_SLTU, FORM_ALU3}, {"sltiu", SIM_SLTU, FORM_ALU3},
+	{"sll", SIM_SLL, FORM_ALU3}, {"sllv", SIM_SLL, FORM_ALU3},
+	{"srl", SIM_SRL, FORM_ALU3}, {"srlv", SIM_SRL, FORM_ALU3},
+	{"sra", SIM_SRA, FORM_ALU3}, {"srav", SIM_SRA, FORM_ALU3},
+	{"mul", SIM_MUL, FORM_ALU3},
+	{"move", SIM_MOVE, FORM_ALU2}, {"not", SIM_NOT, FORM_ALU2}, {"neg", SIM_NEG, FORM_ALU2}, {"negu", SIM_NEG, FORM_ALU2},
+	{"li", SIM_LI, FORM_LI}, {"lui", SIM_LUI, FORM_LI}, {"la", SIM_LA, FORM_LA},
+	{"mult", SIM_MULT, FORM_MULDIV}, {"multu", SIM_MULTU, FORM_MULDIV},
+	{"div", SIM_DIV, FORM_MULDIV}, {"divu", SIM_DIVU, FORM_MULDIV},
+	{"mflo", SIM_MFLO, FORM_MOVE_FROM}, {"mfhi", SIM_MFHI, FORM_MOVE_FROM},
+	{"lw", SIM_LW, FORM_MEMORY}, {"sw", SIM_SW, FORM_MEMORY},
+	{"lb", SIM_LB, FORM_MEMORY}, {"lbu", SIM_LBU, FORM_MEMORY}, {"sb", SIM_SB, FORM_MEMORY},
+	{"beq", SIM_BEQ, FORM_BRANCH}, {"bne", SIM_BNE, FORM_BRANCH},
+	{"blt", SIM_BLT, FORM_BRANCH}, {"ble", SIM_BLE, FORM_BRANCH},
+	{"bgt", SIM_BGT, FORM_BRANCH}, {"bge", SIM_BGE, FORM_BRANCH},
+	{"beqz", SIM_BEQ, FORM_BRANCH_ZERO}, {"bnez", SIM_BNE, FORM_BRANCH_ZERO},
+	{"bltz", SIM_BLT, FORM_BRANCH_ZERO}, {"blez", SIM_BLE, FORM_BRANCH_ZERO},
+	{"bgtz", SIM_BGT, FORM_BRANCH_ZERO}, {"bgez", SIM_BGE, FORM_BRANCH_ZERO},
+	{"b", SIM_J, FORM_JUMP}, {"j", SIM_J, FORM_JUMP}, {"jal", SIM_JAL, FORM_JUMP},
+	{"jr", SIM_JR, FORM_JR}, {"jalr", SIM_JALR, FORM_JALR},
+	{"syscall", SIM_SYSCALL, FORM_NONE}, {"nop", SIM_NOP, FORM_NONE},
+};
+static const size_t MNEMONIC_COUNT = sizeof(MNEMONICS) / sizeof(MNEMONICS[0]);
+
+static bool is_branch(sim_op op) {
+	return op >= SIM_BEQ && op <= SIM_JALR;
+}
+
+static bool is_load(sim_op op) {
+	return op == SIM_LW || op == SIM_LB || op == SIM_LBU;
+}
+
+mips_simulator::mips_simulator() : hi(0), lo(0), out(NULL) {
+	memset(regs, 0, sizeof(regs));
+}
+
+/** loading **/
+
+// a source line of the text segment, decoded once all labels are known
+struct raw_instruction {
+	string op;
+	vector<string> operands;
+	bool delayed;
+	uint32_t line;
+};
+
+bool mips_simulator::load(const string& source, string& error) {
+	istringstream lines(source);
+	string line_text;
+	uint32_t line = 0;
+	bool in_data = false, noreorder = false;
+	vector<string> pending_labels; // data labels waiting for the next item
+	vector<raw_instruction> raw;
+
+	while (getline(lines, line_text)) {
+		line++;
+		string rest = trim(strip_comment(line_text));
+
+		// labels, possibly followed by a directive or an instruction
+		while (true) {
+			size_t end = 0;
+			while (end < rest.size() && is_label_char(rest[end])) {
+				end++;
+			}
+			if (end == 0 || end >= rest.size() || rest[end] != ':') {
+				break;
+			}
+			string label = rest.substr(0, end);
+			if (text_labels.count(label) > 0 || data_labels.count(label) > 0
+					|| find(pending_labels.begin(), pending_labels.end(), label) != pending_labels.end()) {
+				error = line_error(line, "label " + label + " defined twice");
+				return false;
+			}
+			if (in_data) {
+				pending_labels.push_back(label);
+			} else {
+				text_labels[label] = raw.size();
+			}
+			rest = trim(rest.substr(end + 1));
+		}
+		if (rest.empty()) {
+			continue;
+		}
+
+		size_t word_end = rest.find_first_of(" \t");
+		string word = rest.substr(0, word_end);
+		string args = word_end == string::npos ? "" : trim(rest.substr(word_end));
+		if (word[0] == '.') {
+			if (word == ".data" || word == ".text") {
+				for (auto label = pending_labels.begin(); label != pending_labels.end(); label++) {
+					data_labels[*label] = DATA_BASE + data.size();
+				}
+				pending_labels.clear();
+				in_data = word == ".data";
+			} else if (word == ".set") {
+				if (args == "noreorder") {
+					noreorder = true;
+				} else if (args == "reorder") {
+					noreorder = false;
+				}
+			} else if (word == ".globl" || word == ".ent" || word == ".end" || word == ".extern") {
+				// nothing to do
+			} else if (!in_data) {
+				error = line_error(line, word + " outside .data");
+				return false;
+			} else if (!parse_data(word, args, pending_labels, line, error)) {
+				return false;
+			}
+			continue;
+		}
+		if (in_data) {
+			error = line_error(line, "instruction " + word + " in .data");
+			return false;
+		}
+		raw.push_back({word, split_operands(args), noreorder, line});
+	}
+	for (auto label = pending_labels.begin(); label != pending_labels.end(); label++) {
+		data_labels[*label] = DATA_BASE + data.size();
+	}
+
+	text.resize(raw.size());
+	for (size_t i = 0; i < raw.size(); i++) {
+		text[i].delayed = raw[i].delayed;
+		text[i].line = raw[i].line;
+		if (!decode(raw[i].op, raw[i].operands, text[i], error)) {
+			error = line_error(raw[i].line, error);
+			return false;
+		}
+	}
+	for (size_t i = 0; i < text.size(); i++) {
+		if (is_branch(text[i].op) && text[i].delayed
+				&& (i + 1 >= text.size() || is_branch(text[i + 1].op))) {
+			error = line_error(text[i].line, "the delay slot must hold an instruction that is not a branch");
+			return false;
+		}
+	}
+	if (text_labels.count("main") == 0) {
+		error = "no main label";
+		return false;
+	}
+	return true;
+}
+
+// .align, .space and the data items, which first bind the labels before them
+bool mips_simulator::parse_data(const string& directive, const string& args, vector<string>& pending_labels,
+		uint32_t line, string& error) {
+	size_t alignment = 1;
+	if (directive == ".word") {
+		alignment = 4;
+	} else if (directive == ".half") {
+		alignment = 2;
+	} else if (directive == ".align") {
+		int64_t power;
+		if (!parse_number(args, power) || power < 0 || power > 12) {
+			error = line_error(line, "bad .align");
+			return false;
+		}
+		alignment = (size_t) 1 << power;
+	}
+	data.resize((data.size() + alignment - 1) / alignment * alignment);
+	if (directive == ".align") {
+		return true;
+	}
+	for (auto label = pending_labels.begin(); label != pending_labels.end(); label++) {
+		data_labels[*label] = DATA_BASE + data.size();
+	}
+	pending_labels.clear();
+
+	if (directive == ".ascii" || directive == ".asciiz") {
+		if (args.size() < 2 || args[0] != '"' || args.back() != '"') {
+			error = line_error(line, "expected a quoted string");
+			return false;
+		}
+		for (size_t i = 1; i + 1 < args.size(); i++) {
+			char c = args[i];
+			if (c == '\\' && i + 2 < args.size()) {
+				c = args[++i];
+				switch (c) {
+					case 'n': c = '\n'; break;
+					case 't': c = '\t'; break;
+					case '0': c = '\0'; break;
+					default: break; // \\ and \"
+				}
+			}
+			data.push_back(c);
+		}
+		if (directive == ".asciiz") {
+			data.push_back('\0');
+		}
+		return true;
+	}
+	if (directive == ".space") {
+		int64_t size;
+		if (!parse_number(args, size) || size < 0 || data.size() + size > DATA_LIMIT) {
+			error = line_error(line, "bad .space");
+			return false;
+		}
+		data.resize(data.size() + size);
+		return true;
+	}
+
+	size_t size = directive == ".word" ? 4 : directive == ".half" ? 2 : directive == ".byte" ? 1 : 0;
+	if (size == 0) {
+		error = line_error(line, "unknown directive " + directive);
+		return false;
+	}
+	vector<string> values = split_operands(args);
+	for (auto value = values.begin(); value != values.end(); value++) {
+		int64_t number;
+		if (!parse_number(*value, number)) {
+			error = line_error(line, "bad value " + *value);
+			return false;
+		}
+		uint32_t word = (uint32_t) number;
+		for (size_t i = 0; i < size; i++) { // little endian
+			data.push_back((uint8_t) (word >> (8 * i)));
+		}
+	}
+	return true;
+}
+
+bool mips_simulator::decode(const string& op, const vector<string>& operands, sim_instruction& instr, string& error) {
+	const sim_mnemonic* mnemonic = NULL;
+	for (size_t m = 0; m < MNEMONIC_COUNT; m++) {
+		if (op == MNEMONICS[m].name) {
+			mnemonic = &MNEMONICS[m];
+			break;
+		}
+	}
+	if (mnemonic == NULL) {
+		error = "unknown instruction " + op;
+		return false;
+	}
+	instr.op = mnemonic->op;
+	instr.rd = instr.rs = instr.rt = -1;
+	instr.imm = 0;
+	instr.target = 0;
+	instr.words = 1;
+	instr.reads = 0;
+
+	size_t count = operands.size();
+	auto reg = [&](size_t i, int& r) {
+		r = i < count ? parse_register(operands[i]) : -1;
+		if (r < 0) {
+			error = "expected a register as operand " + to_string(i + 1) + " of " + op;
+			return false;
+		}
+		return true;
+	};
+	// a number, or a label with an optional +/- offset
+	auto value = [&](const string& text, int64_t& result) {
+		if (parse_number(text, result)) {
+			return true;
+		}
+		size_t sign = text.find_first_of("+-", 1);
+		string label = trim(text.substr(0, sign));
+		int64_t offset = 0;
+		if (sign != string::npos && !parse_number(trim(text.substr(sign + 1)), offset)) {
+			error = "bad operand " + text;
+			return false;
+		}
+		if (sign != string::npos && text[sign] == '-') {
+			offset = -offset;
+		}
+		if (data_labels.count(label) > 0) {
+			result = data_labels[label] + offset;
+		} else if (text_labels.count(label) > 0) {
+			result = TEXT_BASE + 4 * text_labels[label] + offset;
+		} else {
+			error = "unknown label " + label;
+			return false;
+		}
+		return true;
+	};
+	// a register, or an immediate in imm
+	auto source = [&](size_t i, int& r) {
+		if (i >= count) {
+			error = "missing operand " + to_string(i + 1) + " of " + op;
+			return false;
+		}
+		r = parse_register(operands[i]);
+		if (r >= 0) {
+			return true;
+		}
+		int64_t immediate;
+		if (!parse_number(operands[i], immediate)) {
+			error = "bad operand " + operands[i] + " of " + op;
+			return false;
+		}
+		instr.imm = (int32_t) immediate;
+		return true;
+	};
+	auto branch_target = [&](size_t i) {
+		if (i >= count || text_labels.count(operands[i]) == 0) {
+			error = "unknown branch target in " + op;
+			return false;
+		}
+		instr.target = text_labels[operands[i]];
+		return true;
+	};
+
+	switch (mnemonic->form) {
+		case FORM_ALU3: {
+			int rs;
+			if (count != 3 || !reg(0, instr.rd) || !reg(1, rs) || !source(2, instr.rt)) {
+				if (count != 3) error = op + " takes three operands";
+				return false;
+			}
+			instr.rs = rs;
+			if (instr.rt < 0) { // a 16 bit immediate, or built in $at first
+				bool logical = instr.op == SIM_AND || instr.op == SIM_OR || instr.op == SIM_XOR;
+				bool shift = instr.op == SIM_SLL || instr.op == SIM_SRL || instr.op == SIM_SRA;
+				int64_t immediate = instr.op == SIM_SUB ? -(int64_t) instr.imm : instr.imm;
+				instr.words = shift || (logical ? fits_unsigned16(immediate) : fits_signed16(immediate)) ? 1 : 3;
+			}
+			break;
+		}
+		case FORM_ALU2:
+			if (count != 2 || !reg(0, instr.rd) || !reg(1, instr.rs)) {
+				if (count != 2) error = op + " takes two operands";
+				return false;
+			}
+			break;
+		case FORM_LI: {
+			int64_t immediate;
+			if (count != 2 || !reg(0, instr.rd) || !parse_number(operands[1], immediate)) {
+				if (error.empty()) error = op + " takes a register and a number";
+				return false;
+			}
+			instr.imm = (int32_t) immediate;
+			instr.words = instr.op == SIM_LUI || fits_signed16(immediate) || fits_unsigned16(immediate) ? 1 : 2;
+			break;
+		}
+		case FORM_LA: {
+			int64_t address;
+			if (count != 2 || !reg(0, instr.rd) || !value(operands[1], address)) {
+				if (error.empty()) error = op + " takes a register and an address";
+				return false;
+			}
+			instr.imm = (int32_t) address;
+			instr.words = 2;
+			break;
+		}
+		case FORM_MULDIV:
+			if (count == 3 && (instr.op == SIM_DIV || instr.op == SIM_DIVU)) { // div rd, rs, rt: div and mflo
+				if (!reg(0, instr.rd) || !reg(1, instr.rs) || !reg(2, instr.rt)) {
+					return false;
+				}
+				instr.words = 2;
+			} else if (count != 2 || !reg(0, instr.rs) || !reg(1, instr.rt)) {
+				if (count != 2) error = op + " takes two operands";
+				return false;
+			}
+			break;
+		case FORM_MOVE_FROM:
+			if (count != 1 || !reg(0, instr.rd)) {
+				if (count != 1) error = op + " takes one operand";
+				return false;
+			}
+			instr.reads |= (uint64_t) 1 << (instr.op == SIM_MFLO ? BIT_LO : BIT_HI);
+			break;
+		case FORM_MEMORY: {
+			int value_reg;
+			if (count != 2 || !reg(0, value_reg)) {
+				if (count != 2) error = op + " takes two operands";
+				return false;
+			}
+			if (is_load(instr.op)) {
+				instr.rd = value_reg;
+			} else {
+				instr.rt = value_reg;
+			}
+			const string& address = operands[1];
+			size_t open = address.find('(');
+			int64_t offset = 0;
+			if (open == string::npos) { // absolute, through $at
+				if (!value(address, offset)) {
+					return false;
+				}
+				instr.rs = 0;
+				instr.words = 2;
+			} else {
+				string base = trim(address.substr(open + 1, address.find(')', open) - open - 1));
+				string offset_text = trim(address.substr(0, open));
+				instr.rs = parse_register(base);
+				if (instr.rs < 0 || address.back() != ')') {
+					error = "bad address " + address;
+					return false;
+				}
+				if (!offset_text.empty() && !value(offset_text, offset)) {
+					return false;
+				}
+				instr.words = fits_signed16(offset) ? 1 : 3;
+			}
+			instr.imm = (int32_t) offset;
+			break;
+		}
+		case FORM_BRANCH:
+			if (count != 3 || !reg(0, instr.rs) || !source(1, instr.rt) || !branch_target(2)) {
+				if (count != 3) error = op + " takes three operands";
+				return false;
+			}
+			if (instr.op == SIM_BEQ || instr.op == SIM_BNE) {
+				instr.words = instr.rt >= 0 || instr.imm == 0 ? 1 : 2;
+			} else { // slt or slti into $at, then beq or bne
+				instr.words = instr.rt >= 0 || fits_signed16((int64_t) instr.imm + 1) ? 2 : 3;
+			}
+			break;
+		case FORM_BRANCH_ZERO:
+			if (count != 2 || !reg(0, instr.rs) || !branch_target(1)) {
+				if (count != 2) error = op + " takes two operands";
+				return false;
+			}
+			break;
+		case FORM_JUMP:
+			if (count != 1 || !branch_target(0)) {
+				return false;
+			}
+			if (instr.op == SIM_JAL) {
+				instr.rd = REG_RA;
+			}
+			break;
+		case FORM_JR:
+			if (count != 1 || !reg(0, instr.rs)) {
+				return false;
+			}
+			break;
+		case FORM_JALR:
+			if (count == 1) {
+				instr.rd = REG_RA;
+				if (!reg(0, instr.rs)) {
+					return false;
+				}
+			} else if (count != 2 || !reg(0, instr.rd) || !reg(1, instr.rs)) {
+				return false;
+			}
+			break;
+		case FORM_NONE:
+			if (count != 0) {
+				error = op + " takes no operands";
+				return false;
+			}
+			if (instr.op == SIM_SYSCALL) {
+				instr.reads |= bit(2) | bit(4);
+			}
+			break;
+	}
+	if (instr.op == SIM_MULT || instr.op == SIM_MULTU || instr.op == SIM_DIV || instr.op == SIM_DIVU) {
+		instr.reads |= (uint64_t) 1 << BIT_HI | (uint64_t) 1 << BIT_LO; // waits for the unit
+	}
+	instr.reads |= bit(instr.rs) | bit(instr.rt);
+	return true;
+}
+
+/** machine code **/
+
+bool mips_simulator::load_binary(const string& text_image, const string& data_image, const string& symbols, string& error) {
+	if (text_image.size() % 4 != 0) {
+		error = "the text image is not a whole number of words";
+		return false;
+	}
+	text.resize(text_image.size() / 4);
+	for (size_t i = 0; i < text.size(); i++) {
+		const uint8_t* bytes = (const uint8_t*) text_image.data() + 4 * i;
+		uint32_t word = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+		if (!decode_word(word, i, text[i], error)) {
+			error = line_error(i + 1, error);
+			return false;
+		}
+	}
+	data.assign(data_image.begin(), data_image.end());
+
+	istringstream lines(symbols);
+	string address_text, type, name;
+	while (lines >> address_text >> type >> name) {
+		uint32_t address = strtoul(address_text.c_str(), NULL, 16);
+		if (type == "T" || type == "t") {
+			text_labels[name] = (address - TEXT_BASE) / 4;
+		} else {
+			data_labels[name] = address;
+		}
+	}
+	if (text_labels.count("main") == 0) {
+		error = "no main symbol";
+		return false;
+	}
+	return true;
+}
+
+// one MIPS32 instruction word, as the instruction it is with a delay slot
+bool mips_simulator::decode_word(uint32_t word, uint32_t index, sim_instruction& instr, string& error) {
+	uint32_t opcode = word >> 26, funct = word & 0x3f;
+	int rs = word >> 21 & 31, rt = word >> 16 & 31, rd = word >> 11 & 31;
+	int32_t signed_immediate = (int16_t) (word & 0xffff);
+	int32_t unsigned_immediate = word & 0xffff;
+	instr.rd = instr.rs = instr.rt = -1;
+	instr.imm = 0;
+	instr.target = index + 1 + signed_immediate;
+	instr.words = 1;
+	instr.delayed = true;
+	instr.reads = 0;
+	instr.line = index + 1;
+
+	// rd = rs op rt, or rs op immediate when rt is -1
+	auto alu = [&](sim_op op, int dest, int source, int other, int32_t immediate) {
+		instr.op = op;
+		instr.rd = dest;
+		instr.rs = source;
+		instr.rt = other;
+		instr.imm = immediate;
+	};
+	static const sim_op SHIFTS[4] = {SIM_SLL, SIM_NOP, SIM_SRL, SIM_SRA};
+	switch (opcode) {
+		case 0x00:
+			switch (funct) {
+				case 0x00: case 0x02: case 0x03:
+					if (word == 0) {
+						instr.op = SIM_NOP;
+					} else {
+						alu(SHIFTS[funct], rd, rt, -1, word >> 6 & 31);
+					}
+					break;
+				case 0x04: case 0x06: case 0x07: alu(SHIFTS[funct - 4], rd, rt, rs, 0); break;
+				case 0x08: instr.op = SIM_JR; instr.rs = rs; break;
+				case 0x09: instr.op = SIM_JALR; instr.rd = rd; instr.rs = rs; break;
+				case 0x0c: instr.op = SIM_SYSCALL; instr.reads |= bit(2) | bit(4); break;
+				case 0x10: instr.op = SIM_MFHI; instr.rd = rd; instr.reads |= (uint64_t) 1 << BIT_HI; break;
+				case 0x12: instr.op = SIM_MFLO; instr.rd = rd; instr.reads |= (uint64_t) 1 << BIT_LO; break;
+				case 0x18: alu(SIM_MULT, -1, rs, rt, 0); break;
+				case 0x19: alu(SIM_MULTU, -1, rs, rt, 0); break;
+				case 0x1a: alu(SIM_DIV, -1, rs, rt, 0); break;
+				case 0x1b: alu(SIM_DIVU, -1, rs, rt, 0); break;
+				case 0x20: case 0x21: alu(SIM_ADD, rd, rs, rt, 0); break;
+				case 0x22: case 0x23: alu(SIM_SUB, rd, rs, rt, 0); break;
+				case 0x24: alu(SIM_AND, rd, rs, rt, 0); break;
+				case 0x25: alu(SIM_OR, rd, rs, rt, 0); break;
+				case 0x26: alu(SIM_XOR, rd, rs, rt, 0); break;
+				case 0x27: alu(SIM_NOR, rd, rs, rt, 0); break;
+				case 0x2a: alu(SIM_SLT, rd, rs, rt, 0); break;
+				case 0x2b: alu(SIM_SLTU, rd, rs, rt, 0); break;
+				default: error = "unknown function " + to_string(funct); return false;
+			}
+			break;
+		case 0x1c:
+			if (funct != 0x02) {
+				error = "unknown SPECIAL2 function " + to_string(funct);
+				return false;
+			}
+			alu(SIM_MUL, rd, rs, rt, 0);
+			break;
+		case 0x01: // bltz and bgez compare with 0
+			if (rt > 1) {
+				error = "unknown REGIMM branch " + to_string(rt);
+				return false;
+			}
+			alu(rt == 0 ? SIM_BLT : SIM_BGE, -1, rs, -1, 0);
+			break;
+		case 0x02: case 0x03:
+			instr.op = opcode == 0x02 ? SIM_J : SIM_JAL;
+			instr.rd = opcode == 0x03 ? REG_RA : -1;
+			instr.target = ((((TEXT_BASE + 4 * index + 4) & 0xf0000000) | (word & 0x3ffffff) << 2) - TEXT_BASE) / 4;
+			break;
+		case 0x04: alu(SIM_BEQ, -1, rs, rt, 0); break;
+		case 0x05: alu(SIM_BNE, -1, rs, rt, 0); break;
+		case 0x06: alu(SIM_BLE, -1, rs, -1, 0); break;
+		case 0x07: alu(SIM_BGT, -1, rs, -1, 0); break;
+		case 0x08: case 0x09: alu(SIM_ADD, rt, rs, -1, signed_immediate); break;
+		case 0x0a: alu(SIM_SLT, rt, rs, -1, signed_immediate); break;
+		case 0x0b: alu(SIM_SLTU, rt, rs, -1, signed_immediate); break;
+		case 0x0c: alu(SIM_AND, rt, rs, -1, unsigned_immediate); break;
+		case 0x0d: alu(SIM_OR, rt, rs, -1, unsigned_immediate); break;
+		case 0x0e: alu(SIM_XOR, rt, rs, -1, unsigned_immediate); break;
+		case 0x0f: alu(SIM_LUI, rt, -1, -1, unsigned_immediate); break;
+		case 0x20: alu(SIM_LB, rt, rs, -1, signed_immediate); break;
+		case 0x23: alu(SIM_LW, rt, rs, -1, signed_immediate); break;
+		case 0x24: alu(SIM_LBU, rt, rs, -1, signed_immediate); break;
+		case 0x28: alu(SIM_SB, -1, rs, rt, signed_immediate); break;
+		case 0x2b: alu(SIM_SW, -1, rs, rt, signed_immediate); break;
+		default: error = "unknown opcode " + to_string(opcode); return false;
+	}
+	if (instr.op == SIM_MULT || instr.op == SIM_MULTU || instr.op == SIM_DIV || instr.op == SIM_DIVU) {
+		instr.reads |= (uint64_t) 1 << BIT_HI | (uint64_t) 1 << BIT_LO;
+	}
+	instr.reads |= bit(instr.rs) | bit(instr.rt);
+	return true;
+}
+
+/** memory **/
+
+uint8_t* mips_simulator::address(uint32_t addr, uint32_t size, string& error) {
+	if (addr % size != 0) {
+		ostringstream message;
+		message << "unaligned access at 0x" << hex << addr;
+		error = message.str();
+		return NULL;
+	}
+	if (addr >= DATA_BASE && addr - DATA_BASE < DATA_LIMIT) {
+		uint32_t offset = addr - DATA_BASE;
+		if (offset + size > data.size()) { // the heap grows on first touch
+			data.resize(offset + size);
+		}
+		return &data[offset];
+	}
+	if (addr >= STACK_TOP - STACK_SIZE && addr < STACK_TOP) {
+		return &stack[addr - (STACK_TOP - STACK_SIZE)];
+	}
+	ostringstream message;
+	message << "access to unmapped address 0x" << hex << addr;
+	error = message.str();
+	return NULL;
+}
+
+bool mips_simulator::load_word(uint32_t addr, int32_t& value, string& error) {
+	uint8_t* p = address(addr, 4, error);
+	if (p == NULL) {
+		return false;
+	}
+	memcpy(&value, p, 4);
+	return true;
+}
+
+bool mips_simulator::store_word(uint32_t addr, int32_t value, string& error) {
+	uint8_t* p = address(addr, 4, error);
+	if (p == NULL) {
+		return false;
+	}
+	memcpy(p, &value, 4);
+	return true;
+}
+
+bool mips_simulator::syscall(bool& exited, sim_report& report, string& error) {
+	switch (regs[2]) {
+		case 1: // print_int
+			*out << regs[4];
+			return true;
+		case 4: { // print_string
+			for (uint32_t addr = regs[4]; ; addr++) {
+				uint8_t* c = address(addr, 1, error);
+				if (c == NULL) {
+					return false;
+				}
+				if (*c == '\0') {
+					break;
+				}
+				out->put(*c);
+			}
+			return true;
+		}
+		case 10: // exit
+			exited = true;
+			report.exit_code = 0;
+			return true;
+		case 11: // print_char
+			out->put((char) regs[4]);
+			return true;
+		case 17: // exit2
+			exited = true;
+			report.exit_code = regs[4];
+			return true;
+		default:
+			error = "unsupported syscall " + to_string(regs[2]);
+			return false;
+	}
+}
+
+/** execution **/
+
+bool mips_simulator::run(ostream& out, uint64_t max_instructions, sim_report& report, string& error) {
+	memset(&report, 0, sizeof(report));
+	this->out = &out;
+	stack.assign(STACK_SIZE, 0);
+	memset(regs, 0, sizeof(regs));
+	hi = lo = 0;
+	regs[REG_SP] = STACK_TOP - 4096;
+	regs[REG_RA] = EXIT_ADDRESS;
+
+	uint32_t pc = text_labels["main"];
+	int last_load = -1;        // register the previous instruction loaded
+	uint64_t unit_ready = 0;   // cycle the mult/div result is available
+	uint32_t branch_to = 0;    // where a delayed branch goes after its slot
+	bool branch_pending = false;
+	bool exited = false;
+
+	while (!exited && pc != RETURNED) {
+		if (pc >= text.size()) {
+			error = "ran past the end of the text";
+			return false;
+		}
+		if (report.instructions >= max_instructions) {
+			error = line_error(text[pc].line, "stopped after " + to_string(max_instructions) + " instructions");
+			return false;
+		}
+		const sim_instruction& instr = text[pc];
+		uint32_t next = branch_pending ? branch_to : pc + 1;
+		branch_pending = false;
+
+		// cost
+		report.instructions++;
+		report.machine_instructions += instr.words;
+		report.cycles += instr.words;
+		if (last_load > 0 && (instr.reads & bit(last_load))) {
+			report.cycles++;
+			report.load_use_stalls++;
+		}
+		last_load = is_load(instr.op) ? instr.rd : -1;
+		if ((instr.reads >> BIT_HI) != 0 && report.cycles < unit_ready) {
+			report.multiply_stalls += unit_ready - report.cycles;
+			report.cycles = unit_ready;
+		}
+		if (is_branch(instr.op)) {
+			report.branches++;
+			if (!instr.delayed) {
+				report.cycles++;
+				report.delay_slot_nops++;
+			}
+		}
+
+		int32_t a = instr.rs >= 0 ? regs[instr.rs] : 0;
+		int32_t b = instr.rt >= 0 ? regs[instr.rt] : instr.imm;
+		uint32_t ua = (uint32_t) a, ub = (uint32_t) b;
+		int32_t result = 0;
+		bool writes = instr.rd > 0;
+		bool taken = false;
+		uint32_t target = instr.target;
+		switch (instr.op) {
+			case SIM_ADD: result = (int32_t) (ua + ub); break; // wraps like the IA32 source
+			case SIM_SUB: result = (int32_t) (ua - ub); break;
+			case SIM_AND: result = a & b; break;
+			case SIM_OR: result = a | b; break;
+			case SIM_XOR: result = a ^ b; break;
+			case SIM_NOR: result = ~(a | b); break;
+			case SIM_SLT: result = a < b; break;
+			case SIM_SLTU: result = ua < ub; break;
+			case SIM_SLL: result = (int32_t) (ua << (ub & 31)); break;
+			case SIM_SRL: result = (int32_t) (ua >> (ub & 31)); break;
+			case SIM_SRA: result = a >> (ub & 31); break;
+			case SIM_MUL: result = (int32_t) (ua * ub); break;
+			case SIM_MOVE: result = a; break;
+			case SIM_NOT: result = ~a; break;
+			case SIM_NEG: result = (int32_t) (0u - ua); break;
+			case SIM_LI: result = instr.imm; break;
+			case SIM_LA: result = instr.imm; break;
+			case SIM_LUI: result = (int32_t) ((uint32_t) instr.imm << 16); break;
+			case SIM_MULT: {
+				int64_t product = (int64_t) a * b;
+				lo = (int32_t) product;
+				hi = (int32_t) (product >> 32);
+				unit_ready = report.cycles + MULT_LATENCY;
+				break;
+			}
+			case SIM_MULTU: {
+				uint64_t product = (uint64_t) ua * ub;
+				lo = (int32_t) product;
+				hi = (int32_t) (product >> 32);
+				unit_ready = report.cycles + MULT_LATENCY;
+				break;
+			}
+			case SIM_DIV:
+			case SIM_DIVU:
+				if (b == 0) {
+					error = line_error(instr.line, "division by zero");
+					return false;
+				}
+				if (instr.op == SIM_DIVU) {
+					lo = (int32_t) (ua / ub);
+					hi = (int32_t) (ua % ub);
+				} else if (a == INT32_MIN && b == -1) {
+					lo = a;
+					hi = 0;
+				} else {
+					lo = a / b;
+					hi = a % b;
+				}
+				unit_ready = report.cycles + DIV_LATENCY;
+				if (writes) { // the three operand form waits for its mflo
+					report.multiply_stalls += DIV_LATENCY;
+					report.cycles += DIV_LATENCY;
+					result = lo;
+				}
+				break;
+			case SIM_MFLO: result = lo; break;
+			case SIM_MFHI: result = hi; break;
+			case SIM_LW:
+				if (!load_word(ua + instr.imm, result, error)) {
+					error = line_error(instr.line, error);
+					return false;
+				}
+				break;
+			case SIM_LB:
+			case SIM_LBU: {
+				uint8_t* p = address(ua + instr.imm, 1, error);
+				if (p == NULL) {
+					error = line_error(instr.line, error);
+					return false;
+				}
+				result = instr.op == SIM_LB ? (int32_t) (int8_t) *p : *p;
+				break;
+			}
+			case SIM_SW:
+				if (!store_word(ua + instr.imm, regs[instr.rt], error)) {
+					error = line_error(instr.line, error);
+					return false;
+				}
+				break;
+			case SIM_SB: {
+				uint8_t* p = address(ua + instr.imm, 1, error);
+				if (p == NULL) {
+					error = line_error(instr.line, error);
+					return false;
+				}
+				*p = (uint8_t) regs[instr.rt];
+				break;
+			}
+			case SIM_BEQ: taken = a == b; break;
+			case SIM_BNE: taken = a != b; break;
+			case SIM_BLT: taken = a < b; break;
+			case SIM_BLE: taken = a <= b; break;
+			case SIM_BGT: taken = a > b; break;
+			case SIM_BGE: taken = a >= b; break;
+			case SIM_J: taken = true; break;
+			case SIM_JAL:
+			case SIM_JALR:
+			case SIM_JR: {
+				taken = true;
+				// the return skips the delay slot when there is one
+				result = TEXT_BASE + 4 * (pc + (instr.delayed ? 2 : 1));
+				if (instr.op == SIM_JAL) {
+					break;
+				}
+				if (ua == EXIT_ADDRESS) {
+					target = RETURNED;
+					break;
+				}
+				if (ua < TEXT_BASE || (ua - TEXT_BASE) % 4 != 0 || (ua - TEXT_BASE) / 4 >= text.size()) {
+					ostringstream message;
+					message << "jump to 0x" << hex << ua << " outside the text";
+					error = line_error(instr.line, message.str());
+					return false;
+				}
+				target = (ua - TEXT_BASE) / 4;
+				break;
+			}
+			case SIM_SYSCALL:
+				if (!syscall(exited, report, error)) {
+					error = line_error(instr.line, error);
+					return false;
+				}
+				break;
+			case SIM_NOP:
+				break;
+		}
+		if (writes) {
+			regs[instr.rd] = result;
+		}
+		if (taken) {
+			report.taken_branches++;
+		}
+
+		if (is_branch(instr.op) && instr.delayed) {
+			// the slot runs first, then the branch goes where it decided
+			branch_pending = true;
+			branch_to = taken ? target : pc + 2;
+			next = pc + 1;
+		} else if (taken) {
+			next = target;
+		}
+		pc = next;
+	}
+	out.flush();
+	return true;
+}
+
+void print_report(const sim_report& report, ostream& os) {
+	os << "instructions: " << report.instructions << " (" << report.machine_instructions << " machine)" << endl;
+	os << "cycles: " << report.cycles << " (CPI " << fixed << setprecision(2)
+		<< (report.machine_instructions == 0 ? 0.0 : (double) report.cycles / report.machine_instructions) << ")" << endl;
+	os.unsetf(ios::floatfield);
+	os << "load-use stalls: " << report.load_use_stalls << endl;
+	os << "mult/div stalls: " << report.multiply_stalls << endl;
+	os << "delay slot nops: " << report.delay_slot_nops << endl;
+	os << "branches: " << report.branches << " (" << report.taken_branches << " taken)" << endl;
+}
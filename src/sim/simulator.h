@@ -0,0 +1,108 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+using namespace std;
+
+enum sim_op {
+	SIM_ADD, SIM_SUB, SIM_AND, SIM_OR, SIM_XOR, SIM_NOR, SIM_SLT, SIM_SLTU,
+	SIM_SLL, SIM_SRL, SIM_SRA, SIM_MUL,
+	SIM_MOVE, SIM_NOT, SIM_NEG, SIM_LI, SIM_LA, SIM_LUI,
+	SIM_MULT, SIM_MULTU, SIM_DIV, SIM_DIVU, SIM_MFLO, SIM_MFHI,
+	SIM_LW, SIM_SW, SIM_LB, SIM_LBU, SIM_SB,
+	SIM_BEQ, SIM_BNE, SIM_BLT, SIM_BLE, SIM_BGT, SIM_BGE,
+	SIM_J, SIM_JAL, SIM_JR, SIM_JALR,
+	SIM_SYSCALL, SIM_NOP
+};
+
+// one instruction of the text segment as written in the source, pseudo
+// instructions included. Operands are resolved to register numbers,
+// immediates and addresses when the program is loaded
+struct sim_instruction {
+	sim_op op;
+	int rd;           // written register, -1 for none
+	int rs;
+	int rt;           // -1 when the operand is the immediate
+	int32_t imm;      // immediate, memory offset, or address of la
+	uint32_t target;  // instruction index of a branch or jump
+	int words;        // machine instructions the assembler turns it into
+	bool delayed;     // under .set noreorder: a branch runs the next instruction first
+	uint64_t reads;   // register bits, 32 and 33 are hi and lo
+	uint32_t line;
+};
+
+// what a run did and what it would cost on a single issue five stage
+// pipeline: one cycle per machine instruction, plus a stall cycle for an
+// instruction reading the result of the load right before it, a wait for
+// mult and div results, and the nop the assembler puts in the delay slot of
+// each branch and jump outside .set noreorder
+struct sim_report {
+	uint64_t instructions;          // as written, a pseudo instruction counts once
+	uint64_t machine_instructions;
+	uint64_t cycles;
+	uint64_t load_use_stalls;
+	uint64_t multiply_stalls;
+	uint64_t delay_slot_nops;
+	uint64_t branches;
+	uint64_t taken_branches;
+	int exit_code;
+};
+
+// runs MIPS assembly as the translator writes it: the .data directives,
+// the integer instructions and the pseudo instructions it uses, and the
+// print and exit syscalls. Execution starts at main, with $ra pointing
+// at an exit stub
+class mips_simulator {
+private:
+	static const uint32_t TEXT_BASE = 0x00400000;
+	static const uint32_t EXIT_ADDRESS = TEXT_BASE - 4;
+	static const uint32_t RETURNED = 0xffffffff; // instruction index of EXIT_ADDRESS
+	static const uint32_t DATA_BASE = 0x10010000;
+	static const uint32_t DATA_LIMIT = 64 * 1024 * 1024;
+	static const uint32_t STACK_TOP = 0x80000000;
+	static const uint32_t STACK_SIZE = 8 * 1024 * 1024;
+	static const int MULT_LATENCY = 12;
+	static const int DIV_LATENCY = 35;
+
+	vector<sim_instruction> text;
+	vector<uint8_t> data;
+	vector<uint8_t> stack;
+	unordered_map<string, uint32_t> text_labels; // instruction index
+	unordered_map<string, uint32_t> data_labels; // address
+
+	int32_t regs[32];
+	int32_t hi, lo;
+	ostream* out;
+
+	uint8_t* address(uint32_t addr, uint32_t size, string& error);
+	bool load_word(uint32_t addr, int32_t& value, string& error);
+	bool store_word(uint32_t addr, int32_t value, string& error);
+	bool syscall(bool& exited, sim_report& report, string& error);
+
+	bool parse_data(const string& directive, const string& args, vector<string>& pending_labels, uint32_t line, string& error);
+	bool decode(const string& op, const vector<string>& operands, sim_instruction& instr, string& error);
+	bool decode_word(uint32_t word, uint32_t index, sim_instruction& instr, string& error);
+
+public:
+	mips_simulator();
+
+	// assembles the program, false with the line that failed in error
+	bool load(const string& source, string& error);
+	// loads the machine code the translator writes with --binary: the
+	// little endian .text and .data images and the symbol table, which must
+	// have main. Every branch has a delay slot, and errors give the word
+	// number of the instruction instead of a line
+	bool load_binary(const string& text_image, const string& data_image, const string& symbols, string& error);
+	// runs main, writing what the program prints to out. Stops with an
+	// error after max_instructions
+	bool run(ostream& out, uint64_t max_instructions, sim_report& report, string& error);
+};
+
+void print_report(const sim_report& report, ostream& os);
+
+#endif
@@ -0,0 +1,159 @@
+#include "stats.h"
+#include <iomanip>
+#include <cstdio>
+#include <sys/resource.h>
+
+translation_stats::translation_stats() : files(0), blocks(0), procedures(0), wrong_instructions(0),
+		parse_ns(0), translate_ns(0), write_ns(0) {
+	for (int op = 0; op < OP_COUNT; op++) {
+		instructions[op] = 0;
+		translated[op] = 0;
+		emitted[op] = 0;
+	}
+}
+
+void translation_stats::add_file() {
+	files++;
+}
+
+void translation_stats::add_program(const program& prog, size_t procedure_count) {
+	blocks += prog.block_count();
+	procedures += procedure_count;
+	for (int op = 0; op < OP_COUNT; op++) {
+		instructions[op] += prog.opcode_count((opcode_id) op);
+	}
+}
+
+void translation_stats::add_translated(opcode_id opcode, size_t instruction_count, size_t mips_count) {
+	translated[opcode] += instruction_count;
+	emitted[opcode] += mips_count;
+}
+
+void translation_stats::add_wrong_instruction() {
+	wrong_instructions++;
+}
+
+void translation_stats::add_skipped_procedure(const string& name) {
+	lock_guard<mutex> lock(skipped_mutex);
+	skipped_procedures.push_back(name);
+}
+
+void translation_stats::add_parse_time(double seconds) {
+	parse_ns += (long long) (seconds * 1e9);
+}
+
+void translation_stats::add_translate_time(double seconds) {
+	translate_ns += (long long) (seconds * 1e9);
+}
+
+void translation_stats::add_write_time(double seconds) {
+	write_ns += (long long) (seconds * 1e9);
+}
+
+size_t peak_rss_kb() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+	return usage.ru_maxrss; // kilobytes on Linux
+}
+
+// MIPS instructions per IA32 instruction its handlers consumed
+static double expansion(size_t emitted, size_t translated) {
+	return translated == 0 ? 0.0 : (double) emitted / translated;
+}
+
+void translation_stats::report_text(ostream& os) {
+	size_t total_instructions = 0, total_translated = 0, total_emitted = 0;
+	for (int op = 0; op < OP_COUNT; op++) {
+		total_instructions += instructions[op];
+		total_translated += translated[op];
+		total_emitted += emitted[op];
+	}
+
+	os << fixed << setprecision(3);
+	os << "files: " << files << endl;
+	os << "parse: " << parse_ns / 1e9 << " s" << endl;
+	os << "translate: " << translate_ns / 1e9 << " s" << endl;
+	os << "write: " << write_ns / 1e9 << " s" << endl;
+	os << "blocks: " << blocks << endl;
+	os << "procedures: " << procedures << endl;
+	os << "instructions: " << total_instructions << " in, " << total_emitted << " MIPS out" << endl;
+	os << "wrong instructions: " << wrong_instructions << endl;
+	{
+		lock_guard<mutex> lock(skipped_mutex);
+		os << "skipped procedures: " << skipped_procedures.size();
+		for (size_t p = 0; p < skipped_procedures.size(); p++) {
+			os << (p == 0 ? " (" : ", ") << skipped_procedures[p];
+		}
+		os << (skipped_procedures.empty() ? "" : ")") << endl;
+	}
+	os << "peak RSS: " << peak_rss_kb() << " KB" << endl;
+	os << setprecision(2);
+	os << left << setw(8) << "opcode" << right << setw(12) << "count" << setw(12) << "translated"
+		<< setw(12) << "emitted" << setw(10) << "ratio" << endl;
+	for (int op = 0; op < OP_COUNT; op++) {
+		if (instructions[op] == 0 && translated[op] == 0) {
+			continue;
+		}
+		os << left << setw(8) << opcode_name((opcode_id) op) << right << setw(12) << instructions[op]
+			<< setw(12) << translated[op] << setw(12) << emitted[op]
+			<< setw(10) << expansion(emitted[op], translated[op]) << endl;
+	}
+	os << left << setw(8) << "total" << right << setw(12) << total_instructions
+		<< setw(12) << total_translated << setw(12) << total_emitted
+		<< setw(10) << expansion(total_emitted, total_translated) << endl;
+	os.unsetf(ios::floatfield);
+}
+
+// a JSON string literal, names come from the input's labels and may hold
+// anything but a colon or newline
+static void write_json_string(ostream& os, const string& text) {
+	os << '"';
+	for (size_t c = 0; c < text.size(); c++) {
+		unsigned char ch = text[c];
+		if (ch == '"' || ch == '\\') {
+			os << '\\' << ch;
+		} else if (ch < 0x20) {
+			char escape[8];
+			snprintf(escape, sizeof(escape), "\\u%04x", ch);
+			os << escape;
+		} else {
+			os << ch;
+		}
+	}
+	os << '"';
+}
+
+void translation_stats::report_json(ostream& os) {
+	os << setprecision(6) << fixed;
+	os << "{\"files\": " << files
+		<< ", \"parse_seconds\": " << parse_ns / 1e9
+		<< ", \"translate_seconds\": " << translate_ns / 1e9
+		<< ", \"write_seconds\": " << write_ns / 1e9
+		<< ", \"blocks\": " << blocks
+		<< ", \"procedures\": " << procedures
+		<< ", \"wrong_instructions\": " << wrong_instructions
+		<< ", \"peak_rss_kb\": " << peak_rss_kb()
+		<< ", \"skipped_procedures\": [";
+	{
+		lock_guard<mutex> lock(skipped_mutex);
+		for (size_t p = 0; p < skipped_procedures.size(); p++) {
+			os << (p == 0 ? "" : ", ");
+			write_json_string(os, skipped_procedures[p]);
+		}
+	}
+	os << "], \"opcodes\": {";
+	bool first = true;
+	for (int op = 0; op < OP_COUNT; op++) {
+		if (instructions[op] == 0 && translated[op] == 0) {
+			continue;
+		}
+		os << (first ? "" : ", ") << "\"" << opcode_name((opcode_id) op) << "\": {\"count\": " << instructions[op]
+			<< ", \"translated\": " << translated[op] << ", \"emitted\": " << emitted[op]
+			<< ", \"expansion\": " << expansion(emitted[op], translated[op]) << "}";
+		first = false;
+	}
+	os << "}}" << endl;
+	os.unsetf(ios::floatfield);
+}
@@ -0,0 +1,54 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ostream>
+#include "opcode.h"
+#include "program.h"
+
+using namespace std;
+
+// what a run translated and where its time went, for --stats. The
+// translator adds to it from several threads, so the counters are atomic;
+// times are kept in nanoseconds
+class translation_stats {
+private:
+	atomic<size_t> files;
+	atomic<size_t> blocks;
+	atomic<size_t> procedures;
+	atomic<size_t> wrong_instructions;
+	atomic<size_t> instructions[OP_COUNT]; // in the input
+	atomic<size_t> translated[OP_COUNT];   // consumed by the handlers of each opcode
+	atomic<size_t> emitted[OP_COUNT];      // MIPS instructions those handlers emitted
+	atomic<long long> parse_ns;
+	atomic<long long> translate_ns;
+	atomic<long long> write_ns;
+	mutex skipped_mutex;
+	vector<string> skipped_procedures; // not reachable from the entry label
+
+public:
+	translation_stats();
+
+	void add_file();
+	// the input of prog, which may be one file or one procedure of a stream
+	void add_program(const program& prog, size_t procedure_count);
+	// a handler of opcode consumed instruction_count instructions and
+	// emitted mips_count instructions for them
+	void add_translated(opcode_id opcode, size_t instruction_count, size_t mips_count);
+	void add_wrong_instruction();
+	void add_skipped_procedure(const string& name);
+	void add_parse_time(double seconds);
+	void add_translate_time(double seconds);
+	void add_write_time(double seconds);
+
+	void report_text(ostream& os);
+	void report_json(ostream& os);
+};
+
+// the peak resident set size of the process so far
+size_t peak_rss_kb();
+
+#endif
@@ -0,0 +1,111 @@
+#include "strength.h"
+#include <stdlib.h>
+#include <stdint.h>
+
+static bool is_power_of_two(uint32_t value) {
+	return value != 0 && (value & (value - 1)) == 0;
+}
+
+static int log2_of(uint32_t value) {
+	int bits = 0;
+	while (value > 1) {
+		value >>= 1;
+		bits++;
+	}
+	return bits;
+}
+
+multiply_plan plan_multiply(int constant) {
+	multiply_plan plan;
+	plan.form = multiply_plan::MULT;
+	plan.high = 0;
+	plan.low = 0;
+	plan.negate = constant < 0;
+
+	if (constant == 0) {
+		plan.form = multiply_plan::ZERO;
+		plan.negate = false;
+		return plan;
+	}
+
+	uint32_t magnitude = constant < 0 ? 0u - (uint32_t) constant : (uint32_t) constant;
+	if (is_power_of_two(magnitude)) {
+		plan.form = magnitude == 1 ? multiply_plan::COPY : multiply_plan::SHIFT;
+		plan.high = log2_of(magnitude);
+		return plan;
+	}
+
+	// magnitude = odd << low, and odd is 2^n + 1 or 2^n - 1
+	int low = 0;
+	uint32_t odd = magnitude;
+	while ((odd & 1) == 0) {
+		odd >>= 1;
+		low++;
+	}
+	if (is_power_of_two(odd - 1)) {
+		plan.form = multiply_plan::SHIFT_ADD;
+		plan.high = log2_of(odd - 1) + low;
+		plan.low = low;
+	} else if (is_power_of_two(odd + 1)) {
+		plan.form = multiply_plan::SHIFT_SUB;
+		plan.high = log2_of(odd + 1) + low;
+		plan.low = low;
+	} else {
+		plan.negate = false;
+	}
+	return plan;
+}
+
+bool is_number(text_ref text) {
+	if (text.empty() || text.size() >= 32) {
+		return false;
+	}
+	char buffer[32];
+	memcpy(buffer, text.data(), text.size());
+	buffer[text.size()] = '\0';
+	char* end;
+	strtol(buffer, &end, 0);
+	return end != buffer && *end == '\0';
+}
+
+void emit_multiply(emitter& out, text_ref dst, text_ref src, int constant, text_ref temp) {
+	multiply_plan plan = plan_multiply(constant);
+	switch (plan.form) {
+		case multiply_plan::ZERO:
+			out.emit(1, "li", {dst, "0"});
+			return;
+		case multiply_plan::COPY:
+			if (plan.negate) {
+				out.emit(1, "subu", {dst, "$zero", src});
+				return;
+			}
+			if (dst != src) {
+				out.emit(1, "add", {dst, "$zero", src});
+			}
+			return;
+		case multiply_plan::SHIFT:
+			out.emit(1, "sll", {dst, src, mips_operand::num(plan.high)});
+			break;
+		case multiply_plan::SHIFT_ADD:
+		case multiply_plan::SHIFT_SUB: {
+			// src is read again after the first shift, so it cannot accumulate in dst
+			text_ref accumulator = dst == src ? temp : dst;
+			text_ref sum = plan.low == 0 ? dst : accumulator;
+			const char* op = plan.form == multiply_plan::SHIFT_ADD ? "addu" : "subu";
+			out.emit(1, "sll", {accumulator, src, mips_operand::num(plan.high - plan.low)});
+			out.emit(1, op, {sum, accumulator, src});
+			if (plan.low > 0) {
+				out.emit(1, "sll", {dst, accumulator, mips_operand::num(plan.low)});
+			}
+			break;
+		}
+		case multiply_plan::MULT:
+			out.emit(1, "addi", {temp, "$zero", mips_operand::num(constant)});
+			out.emit(1, "mult", {temp, src});
+			out.emit(1, "mflo", {dst});
+			return;
+	}
+	if (plan.negate) {
+		out.emit(1, "subu", {dst, "$zero", dst});
+	}
+}
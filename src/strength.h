@@ -0,0 +1,38 @@
+#ifndef STRENGTH_H
+#define STRENGTH_H
+
+#include "text_ref.h"
+#include "emitter.h"
+
+using namespace std;
+
+// a multiply by a constant rewritten as shifts and adds. mult/mflo takes
+// several cycles on MIPS, each of these forms is at most four one-cycle
+// instructions
+struct multiply_plan {
+	enum form_t {
+		ZERO,      // x * 0
+		COPY,      // x * 1
+		SHIFT,     // x << high
+		SHIFT_ADD, // ((x << (high - low)) + x) << low
+		SHIFT_SUB, // ((x << (high - low)) - x) << low
+		MULT       // no cheaper sequence
+	};
+
+	form_t form;
+	int high;
+	int low;
+	bool negate; // the result is negated afterwards
+};
+
+multiply_plan plan_multiply(int constant);
+
+// whether text is a whole decimal, 0x hexadecimal or octal number, the
+// immediates of a multiply may also be symbols
+bool is_number(text_ref text);
+
+// emits dst = src * constant. temp is clobbered when dst and src are the same
+// register, or when no cheaper sequence exists and mult is used
+void emit_multiply(emitter& out, text_ref dst, text_ref src, int constant, text_ref temp);
+
+#endif
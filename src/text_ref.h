@@ -0,0 +1,46 @@
+#ifndef TEXT_REF_H
+#define TEXT_REF_H
+
+#include <string>
+#include <cstring>
+
+using namespace std;
+
+// non-owning view of a run of characters, e.g. a token inside the input buffer
+class text_ref {
+private:
+	const char* ptr;
+	size_t len;
+
+public:
+	text_ref() : ptr(NULL), len(0) {}
+	text_ref(const char* ptr, size_t len) : ptr(ptr), len(len) {}
+	text_ref(const char* s) : ptr(s), len(strlen(s)) {}
+	text_ref(const char* begin, const char* end) : ptr(begin), len(end - begin) {}
+	text_ref(const string& s) : ptr(s.data()), len(s.size()) {}
+
+	const char* data() const { return ptr; }
+	size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+	char operator[](size_t i) const { return ptr[i]; }
+
+	const char* begin() const { return ptr; }
+	const char* end() const { return ptr + len; }
+
+	string str() const { return len == 0 ? string() : string(ptr, len); }
+
+	bool operator==(text_ref other) const {
+		return len == other.len && (len == 0 || memcmp(ptr, other.ptr, len) == 0);
+	}
+	bool operator!=(text_ref other) const {
+		return !(*this == other);
+	}
+	bool operator==(const char* s) const {
+		return *this == text_ref(s, strlen(s));
+	}
+	bool operator!=(const char* s) const {
+		return !(*this == s);
+	}
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+
+thread_pool::thread_pool(size_t thread_count) :
+	queued(0), pending(0), next_queue(0), stopping(false) {
+	if (thread_count == 0) {
+		thread_count = thread::hardware_concurrency();
+	}
+	if (thread_count == 0) {
+		thread_count = 1;
+	}
+
+	for (size_t i = 0; i < thread_count; i++) {
+		queues.push_back(unique_ptr<worker_queue>(new worker_queue));
+	}
+	for (size_t i = 0; i < thread_count; i++) {
+		workers.push_back(thread(&thread_pool::run, this, i));
+	}
+}
+
+size_t thread_pool::size() {
+	return workers.size();
+}
+
+void thread_pool::submit(function<void()> task) {
+	size_t id;
+	{
+		lock_guard<mutex> guard(state_lock);
+		id = next_queue;
+		next_queue = (next_queue + 1) % queues.size();
+	}
+	{
+		lock_guard<mutex> guard(queues[id]->lock);
+		queues[id]->tasks.push_back(task);
+	}
+	{
+		lock_guard<mutex> guard(state_lock);
+		queued++;
+		pending++;
+	}
+	work_available.notify_one();
+}
+
+bool thread_pool::take_task(size_t id, function<void()>& task) {
+	// own queue first, newest task
+	{
+		lock_guard<mutex> guard(queues[id]->lock);
+		if (!queues[id]->tasks.empty()) {
+			task = queues[id]->tasks.back();
+			queues[id]->tasks.pop_back();
+			return true;
+		}
+	}
+	// then steal the oldest task of another worker
+	for (size_t i = 1; i < queues.size(); i++) {
+		worker_queue& victim = *queues[(id + i) % queues.size()];
+		lock_guard<mutex> guard(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = victim.tasks.front();
+			victim.tasks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
+
+void thread_pool::run(size_t id) {
+	while (true) {
+		{
+			unique_lock<mutex> guard(state_lock);
+			work_available.wait(guard, [this] { return queued > 0 || stopping; });
+			if (queued == 0) {
+				return;
+			}
+			queued--; // claims one of the queued tasks
+		}
+
+		// the claimed task sits in some queue, find it
+		function<void()> task;
+		while (!take_task(id, task)) {}
+
+		task();
+
+		{
+			lock_guard<mutex> guard(state_lock);
+			pending--;
+			if (pending == 0) {
+				all_done.notify_all();
+			}
+		}
+	}
+}
+
+void thread_pool::wait() {
+	unique_lock<mutex> guard(state_lock);
+	all_done.wait(guard, [this] { return pending == 0; });
+}
+
+thread_pool::~thread_pool() {
+	{
+		lock_guard<mutex> guard(state_lock);
+		stopping = true;
+	}
+	work_available.notify_all();
+	for (auto worker = workers.begin(); worker != workers.end(); worker++) {
+		worker->join();
+	}
+}
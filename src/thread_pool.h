@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+// fixed set of worker threads, each with its own task queue. A worker takes
+// its newest task first and, when its queue runs dry, steals the oldest task
+// from another worker, so uneven tasks spread out over the pool
+class thread_pool {
+private:
+	struct worker_queue {
+		mutex lock;
+		deque<function<void()> > tasks;
+	};
+
+	vector<thread> workers;
+	vector<unique_ptr<worker_queue> > queues;
+
+	mutex state_lock;
+	condition_variable work_available;
+	condition_variable all_done;
+	size_t queued;   // tasks waiting in some queue
+	size_t pending;  // tasks submitted and not finished yet
+	size_t next_queue;
+	bool stopping;
+
+	void run(size_t id);
+	bool take_task(size_t id, function<void()>& task);
+
+public:
+	// thread_count 0 uses one thread per core
+	thread_pool(size_t thread_count = 0);
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	size_t size();
+	void submit(function<void()> task);
+	// blocks until every submitted task has finished
+	void wait();
+
+	~thread_pool();
+};
+
+#endif
@@ -1,651 +1,1252 @@
 #include "translator.h"
+#include "strength.h"
+#include "cfg.h"
 #include <iostream>
-#include <algorithm>
 #include <sstream>
+#include <chrono>
+
+translator::translator() : optimizer(NULL), scheduler(NULL), cache(NULL), stats(NULL), print(PRINT_INLINE),
+	use_liveness(true), instrument(false), promote(false), reuse_addresses(false) {
+    registers_map[REG_EAX] = "$t0";
+    registers_map[REG_ECX] = "$t1";
+    registers_map[REG_EDX] = "$t2";
+    registers_map[REG_EBX] = "$s0";
+    registers_map[REG_ESI] = "$s1";
+    registers_map[REG_EDI] = "$s2";
+    registers_map[REG_ESP] = "$sp";
+    registers_map[REG_EBP] = "$fp";
+	registers_map[REG_TEMP] = "$s7";
+	registers_map[REG_ADDRESSING_RESULT] = "$s6";
+	registers_map[REG_ZERO] = "$zero";
+
+	const char* promoted[frame_promotion::REGISTER_COUNT] = {"$s3", "$s4", "$s5", "$t3", "$t4", "$t5", "$t6", "$t7", "$t8", "$t9"};
+	for (int r = 0; r < frame_promotion::REGISTER_COUNT; r++) {
+		promotion_registers[r] = promoted[r];
+	}
+	// $s6, then the $t registers promotion would use last, $t9 down to $t3
+	address_registers[0] = registers_map[REG_ADDRESSING_RESULT];
+	for (int r = 1; r < address_reuse::REGISTER_COUNT; r++) {
+		address_registers[r] = promotion_registers[frame_promotion::REGISTER_COUNT - r];
+	}
 
-translator::translator() {
-    registers_map["%eax"] = "$t0";
-    registers_map["%ecx"] = "$t1";
-    registers_map["%edx"] = "$t2";
-    registers_map["%ebx"] = "$s0";
-    registers_map["%esi"] = "$s1";
-    registers_map["%edi"] = "$s2";
-    registers_map["%esp"] = "$sp";
-    registers_map["%ebp"] = "$fp";
-	registers_map["temp"] = "$s7";
-	registers_map["addressing_result"] = "$s6";
-	registers_map["zero"] = "$zero";
-}
-
-string translator::translate_IA32_to_MIPS(parser parser) {
-    string output = "";
-    // TODO translate .data
-    output += ".data\n\tnewline: .asciiz \"\\n\"\n";
-    output += ".text\n";
-	vector<block*> blocks = parser.get_code_blocks();
-    bool is_procedure_head = true;
-    string procedure_name;
-    for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
-		block* block = *b_iter;
-        if (block->get_label() != "") { // add procedure head label
-            if (is_procedure_head) {
-                output += ".globl " + block->get_label() + "\n";
-                output += ".ent " + block->get_label() + "\n";
-                procedure_name = block->get_label();
-                is_procedure_head = false;
-            }
-            output += block->get_label() + ":\n";
+	for (int op = 0; op < OP_COUNT; op++) {
+		dispatch_table[op] = &translator::dispatch_skip;
+	}
+	dispatch_table[OP_MOVL] = &translator::dispatch_single<&translator::translate_movl>;
+	dispatch_table[OP_ADDL] = &translator::dispatch_single<&translator::translate_addl_andl_xorl_orl>;
+	dispatch_table[OP_XORL] = &translator::dispatch_single<&translator::translate_addl_andl_xorl_orl>;
+	dispatch_table[OP_ANDL] = &translator::dispatch_single<&translator::translate_addl_andl_xorl_orl>;
+	dispatch_table[OP_ORL] = &translator::dispatch_single<&translator::translate_addl_andl_xorl_orl>;
+	dispatch_table[OP_SUBL] = &translator::dispatch_single<&translator::translate_subl>;
+	dispatch_table[OP_IMULL] = &translator::dispatch_single<&translator::translate_imull>;
+	dispatch_table[OP_IDIVL] = &translator::dispatch_single<&translator::translate_idivl>;
+	dispatch_table[OP_SALL] = &translator::dispatch_single<&translator::translate_sall_or_shll>;
+	dispatch_table[OP_SHLL] = &translator::dispatch_single<&translator::translate_sall_or_shll>;
+	dispatch_table[OP_SARL] = &translator::dispatch_single<&translator::translate_sarl>;
+	dispatch_table[OP_SHRL] = &translator::dispatch_single<&translator::translate_shrl>;
+	dispatch_table[OP_INCL] = &translator::dispatch_single<&translator::translate_incl>;
+	dispatch_table[OP_DECL] = &translator::dispatch_single<&translator::translate_decl>;
+	dispatch_table[OP_NEGL] = &translator::dispatch_single<&translator::translate_negl>;
+	dispatch_table[OP_NOTL] = &translator::dispatch_single<&translator::translate_notl>;
+	dispatch_table[OP_PUSHL] = &translator::dispatch_pushl;
+	dispatch_table[OP_POPL] = &translator::dispatch_single<&translator::translate_popl>;
+	dispatch_table[OP_LEAVE] = &translator::dispatch_leave;
+	dispatch_table[OP_CALL] = &translator::dispatch_single<&translator::translate_call>;
+	dispatch_table[OP_CMPL] = &translator::dispatch_cmpl;
+	dispatch_table[OP_JMP] = &translator::dispatch_single<&translator::translate_jmp>;
+	dispatch_table[OP_PRN] = &translator::dispatch_single<&translator::translate_prn>;
+	dispatch_table[OP_INT] = &translator::dispatch_single<&translator::translate_int>;
+}
+
+void translator::translate_IA32_to_MIPS(parser& parser, ostream& os, thread_pool* pool) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (use_liveness) {
+        parser.analyze_liveness();
+    }
+    if (promote) {
+        parser.analyze_frames();
+    }
+    if (reuse_addresses) {
+        parser.analyze_addresses();
+    }
+    emitter out(os);
+    out.set_optimizer(optimizer);
+    out.set_scheduler(scheduler);
+	index_range<block> blocks = parser.get_code_blocks();
+    vector<string> counter_labels;
+    if (instrument) {
+        collect_counter_labels(blocks, counter_labels);
+    }
+    translate_data(out);
+    if (!counter_labels.empty()) {
+        translate_counters(counter_labels, out);
+    }
+    out.append(".text\n");
+    if (scheduler != NULL) {
+        out.append(".set noreorder\n");
+    }
+    bool print_routine = use_print_routine(parser.get_program());
+    if (print_routine) {
+        translate_print_routine(out);
+    }
+    if (!counter_labels.empty()) {
+        translate_dump_routine(counter_labels.size(), out);
+    }
+    if (!entry.empty()) {
+        vector<cached_procedure> procedures, skipped;
+        reachable_procedures(parser, procedures, skipped);
+        translate_procedures(blocks, procedures, cache_options(print_routine, false), pool, out);
+        for (auto procedure = skipped.begin(); stats != NULL && procedure != skipped.end(); procedure++) {
+            stats->add_skipped_procedure(procedure->name.empty() ? "(unlabeled)" : procedure->name.str());
         }
+    } else if (cache != NULL) {
+        vector<cached_procedure> procedures;
+        split_procedures(blocks, procedures);
+        translate_procedures(blocks, procedures, cache_options(print_routine, false), pool, out);
+    } else if (pool != NULL && pool->size() > 1) {
+        translate_parallel(blocks, *pool, out);
+    } else {
+        translate_sequential(blocks, out);
+    }
 
-		vector<instruction*> instructions = block->get_instructions();
-        for (auto i_iter = instructions.begin(); i_iter != instructions.end(); ) {
-            string translated_insts = "";
-			instruction* instr = *i_iter;
-			string op = instr->get_op();
-
-            if (op == "movl") {
-                translated_insts += translate_movl(instr);
-				i_iter++;
-            } else if (op == "addl" || op == "xorl" || op == "andl" || op == "orl") {
-                translated_insts += translate_addl_andl_xorl_orl(instr);
-				i_iter++;
-            } else if (op == "subl") {
-                translated_insts += translate_subl(instr);
-				i_iter++;
-            } else if (op == "imull") {
-                translated_insts += translate_imull(instr);
-				i_iter++;
-            } else if (op == "idivl") {
-                translated_insts += translate_idivl(instr);
-                i_iter++;
-            } else if (op == "sall" || op == "shll" ) {
-                translated_insts += translate_sall_or_shll(instr);
-				i_iter++;
-            } else if (op == "sarl") {
-                translated_insts += translate_sarl(instr);
-				i_iter++;
-            } else if (op == "shrl") {
-                translated_insts += translate_shrl(instr);
-				i_iter++;
-            } else if (op == "incl") {
-                translated_insts += translate_incl(instr);
-				i_iter++;
-            } else if (op == "decl") {
-                translated_insts += translate_decl(instr);
-				i_iter++;
-            } else if (op == "negl") {
-                translated_insts += translate_negl(instr);
-				i_iter++;
-            } else if (op == "notl") {
-                translated_insts += translate_notl(instr);
-				i_iter++;
-            } else if (op == "pushl") {
-				if (instr->get_operand1() == "%ebp") {
-					// procedure head setup
-					translated_insts += translate_procedure_head();
-					i_iter++;
-					i_iter++;
-				} else {
-					vector<instruction*> inst_buffer;
-					int argument_count = 0;
-
-					while (i_iter != instructions.end() && (*i_iter)->get_op() == "pushl") {
-						inst_buffer.push_back(*i_iter);
-						i_iter++;
-						argument_count++;
-					}
-
-					if (i_iter != instructions.end() && (*i_iter)->get_op() == "call") {
-						// procedure arguments
-						inst_buffer.push_back(*i_iter);
-						i_iter++;
-						translated_insts += translate_call_with_arguments(inst_buffer, argument_count);
-					} else {
-						// normal pushl
-						translated_insts += translate_batch_pushl(inst_buffer);
-					}
-				}
-			} else if (op == "popl") {
-				translated_insts += translate_popl(instr);
-				i_iter++;
-            } else if (op == "leave") {
-				// procedure end setup
-				translated_insts += translate_procedure_end();
-                is_procedure_head = true;
-				i_iter++;
-				i_iter++;
-			} else if (op == "call") {
-				translated_insts += translate_call(instr);
-				i_iter++;
-			} else if (op == "cmpl") {
-				instruction* cmpl_inst = instr;
-				i_iter++;
-				instruction* j_inst = *i_iter;
-				i_iter++;
-				translated_insts += translate_cmpl_j(cmpl_inst, j_inst);
-			} else if (op == "jmp") {
-                translated_insts += translate_jmp(instr);
-                i_iter++;
-            } else if (op == "prn") {
-                translated_insts += translate_prn(instr);
-                i_iter++;
-            } else if (op == "cltd") {
-                i_iter++;
-            } else if (op == "int") {
-                translated_insts += translate_int(instr);
-                i_iter++;
+    if (stats != NULL) {
+        vector<cached_procedure> procedures;
+        split_procedures(blocks, procedures);
+        size_t procedure_count = 0;
+        for (auto procedure = procedures.begin(); procedure != procedures.end(); procedure++) {
+            procedure_count += procedure->ends;
+        }
+        out.flush();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        stats->add_file();
+        stats->add_program(parser.get_program(), procedure_count);
+        stats->add_translate_time(seconds - out.get_write_seconds());
+        stats->add_write_time(out.get_write_seconds());
+    }
+}
+
+// Each procedure is translated and written before the next one is read, so
+// only one procedure is held at a time. What file mode decides for the
+// whole input is decided per procedure here: PRINT_AUTO picks the print
+// form of each procedure (the routine is always written), liveness treats
+// jumps to other procedures as leaving, and the block counters go in a
+// second data section at the end
+void translator::translate_stream(parser& parser, ostream& os, ostream* block_map) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    double parse_seconds = 0;
+    emitter out(os);
+    out.set_optimizer(optimizer);
+    out.set_scheduler(scheduler);
+    translate_data(out);
+    out.append(".text\n");
+    if (scheduler != NULL) {
+        out.append(".set noreorder\n");
+    }
+    bool print_routine = print != PRINT_INLINE;
+    if (print_routine) {
+        translate_print_routine(out);
+    }
+    string options = cache_options(print_routine, true);
+    vector<string> counter_labels;
+    while (true) {
+        chrono::steady_clock::time_point parse_start = chrono::steady_clock::now();
+        bool more = parser.next_procedure();
+        parse_seconds += chrono::duration<double>(chrono::steady_clock::now() - parse_start).count();
+        if (!more) {
+            break;
+        }
+        if (use_liveness) {
+            parser.analyze_liveness();
+        }
+        if (promote) {
+            parser.analyze_frames();
+        }
+        if (reuse_addresses) {
+            parser.analyze_addresses();
+        }
+        index_range<block> blocks = parser.get_code_blocks();
+        if (instrument) {
+            if (block_map != NULL) {
+                write_block_map(parser, *block_map, counter_labels.size());
             }
+            collect_counter_labels(blocks, counter_labels);
+        }
+        vector<cached_procedure> procedures;
+        split_procedures(blocks, procedures);
+        translate_procedures(blocks, procedures, options, NULL, out);
+        if (stats != NULL) {
+            size_t procedure_count = 0;
+            for (auto procedure = procedures.begin(); procedure != procedures.end(); procedure++) {
+                procedure_count += procedure->ends;
+            }
+            stats->add_program(parser.get_program(), procedure_count);
+        }
+        out.flush();
+        os.flush();
+    }
+    if (!counter_labels.empty()) {
+        out.append(".data\n");
+        translate_counters(counter_labels, out);
+        out.append(".text\n");
+        translate_dump_routine(counter_labels.size(), out);
+    }
+
+    out.flush();
+    if (stats != NULL) {
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        stats->add_file();
+        stats->add_parse_time(parse_seconds);
+        stats->add_translate_time(seconds - parse_seconds - out.get_write_seconds());
+        stats->add_write_time(out.get_write_seconds());
+    }
+}
 
-            output += translated_insts;
+void translator::translate_sequential(index_range<block> blocks, emitter& out) {
+    bool is_procedure_head = true;
+    text_ref procedure_name;
+    size_t procedure_slots = out.get_delay_slots(), procedure_filled = out.get_filled_slots();
+    for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+        translate_block_head(*b_iter, is_procedure_head, procedure_name, out);
+        if (translate_block(*b_iter, out)) {
+            is_procedure_head = true;
         }
+        if (translate_block_end(*b_iter, is_procedure_head, procedure_name, out) && scheduler != NULL) {
+            scheduler->record(procedure_name, out.get_delay_slots() - procedure_slots,
+                out.get_filled_slots() - procedure_filled);
+            procedure_slots = out.get_delay_slots();
+            procedure_filled = out.get_filled_slots();
+        }
+    }
+}
 
-        if (block->get_label() != "" && is_procedure_head) { // add procedure end label
-            output += ".end " + procedure_name + "\n";
+void translator::translate_block_head(block block, bool& is_procedure_head, text_ref& procedure_name, emitter& out) {
+	text_ref label = block.get_label();
+    if (!label.empty()) { // add procedure head label
+        if (is_procedure_head) {
+            out.append(".globl "); out.append(label); out.append('\n');
+            out.append(".ent "); out.append(label); out.append('\n');
+            procedure_name = label;
+            is_procedure_head = false;
+        }
+        out.append(label); out.append(":\n");
+        if (instrument) {
+            translate_block_counter(label, out);
         }
-        output += "\n";
     }
-    return output;
 }
 
-string translator::translate_procedure_head() {
-	string translated_inst = "";
-	translated_inst += instruction::to_string(1, "addi", {"$sp", "$sp", "-8"});
-	translated_inst += instruction::to_string(1, "sw", {"$ra", "4($sp)"});
-	translated_inst += instruction::to_string(1, "sw", {"$fp", "0($sp)"});
-	translated_inst += instruction::to_string(1, "addi", {"$fp", "$sp", "0"});
+// returns whether the block left its procedure
+bool translator::translate_block(block block, emitter& out) {
+	bool leaves = false;
+	index_range<instruction> instructions = block.get_instructions();
+    for (auto i_iter = instructions.begin(); i_iter != instructions.end(); ) {
+		opcode_id op = i_iter->get_opcode();
+		if (stats != NULL) {
+			instruction_iter first = i_iter;
+			size_t emitted = out.get_instruction_count();
+			(this->*dispatch_table[op])(i_iter, instructions.end(), out);
+			stats->add_translated(op, i_iter - first, out.get_instruction_count() - emitted);
+		} else {
+			(this->*dispatch_table[op])(i_iter, instructions.end(), out);
+		}
+        if (op == OP_LEAVE) {
+            leaves = true;
+        }
+    }
+    return leaves;
+}
+
+// returns whether the block ended its procedure
+bool translator::translate_block_end(block block, bool is_procedure_head, text_ref procedure_name, emitter& out) {
+    bool ends = !block.get_label().empty() && is_procedure_head;
+    if (ends) { // add procedure end label
+        out.append(".end "); out.append(procedure_name); out.append('\n');
+    }
+    out.append('\n');
+    return ends;
+}
+
+void translator::translate_range(index_range<block> blocks, translated_range& range) {
+	ostringstream os;
+	{
+		emitter out(os);
+		out.set_optimizer(optimizer);
+		out.set_scheduler(scheduler);
+		for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+			range.block_leaves.push_back(translate_block(*b_iter, out));
+			range.block_ends.push_back(out.get_position());
+			range.block_slots.push_back(out.get_delay_slots());
+			range.block_filled.push_back(out.get_filled_slots());
+		}
+	}
+	range.text = os.str();
+}
+
+// Only the .globl/.ent/.end lines depend on what came before a block, so the
+// blocks' code is translated concurrently in runs of whole procedures, and
+// those lines are added while the runs are written out in order. Runs are
+// handed out in waves of a few per thread to bound the memory held.
+void translator::translate_parallel(index_range<block> blocks, thread_pool& pool, emitter& out) {
+	size_t wave_size = 4 * pool.size();
+	bool is_procedure_head = true;
+	text_ref procedure_name;
+	size_t procedure_slots = 0, procedure_filled = 0;
+
+	auto b_iter = blocks.begin();
+	while (b_iter != blocks.end()) {
+		vector<translated_range> wave;
+		while (b_iter != blocks.end() && wave.size() < wave_size) {
+			translated_range range;
+			range.first_block = b_iter.get_index();
+			size_t instruction_count = 0;
+			while (b_iter != blocks.end()) {
+				index_range<instruction> instructions = b_iter->get_instructions();
+				bool leaves = false;
+				for (auto i_iter = instructions.begin(); i_iter != instructions.end(); i_iter++) {
+					leaves |= i_iter->get_opcode() == OP_LEAVE;
+				}
+				instruction_count += instructions.size();
+				b_iter++;
+				if (leaves && instruction_count >= MIN_RANGE_INSTRUCTIONS) {
+					break;
+				}
+			}
+			range.last_block = b_iter.get_index();
+			wave.push_back(range);
+		}
 
-	return translated_inst;
+		for (auto range = wave.begin(); range != wave.end(); range++) {
+			translated_range* target = &*range;
+			pool.submit([this, blocks, target] {
+				translate_range(blocks.slice(target->first_block, target->last_block), *target);
+			});
+		}
+		pool.wait();
+
+		for (auto range = wave.begin(); range != wave.end(); range++) {
+			size_t code_begin = 0, slots_begin = 0, filled_begin = 0;
+			for (uint32_t b = range->first_block; b < range->last_block; b++) {
+				size_t i = b - range->first_block;
+				block block = blocks.slice(b, b + 1)[0];
+				translate_block_head(block, is_procedure_head, procedure_name, out);
+				out.append(text_ref(range->text.data() + code_begin, range->block_ends[i] - code_begin));
+				procedure_slots += range->block_slots[i] - slots_begin;
+				procedure_filled += range->block_filled[i] - filled_begin;
+				if (range->block_leaves[i]) {
+					is_procedure_head = true;
+				}
+				if (translate_block_end(block, is_procedure_head, procedure_name, out) && scheduler != NULL) {
+					scheduler->record(procedure_name, procedure_slots, procedure_filled);
+					procedure_slots = procedure_filled = 0;
+				}
+				code_begin = range->block_ends[i];
+				slots_begin = range->block_slots[i];
+				filled_begin = range->block_filled[i];
+			}
+		}
+	}
 }
 
-string translator::translate_procedure_end() {
-	string translated_inst = "";
-	translated_inst += instruction::to_string(1, "lw", {"$fp", "0($sp)"});
-	translated_inst += instruction::to_string(1, "lw", {"$ra", "4($sp)"});
-	translated_inst += instruction::to_string(1, "add", {"$sp", "$sp", "8"});
-	translated_inst += instruction::to_string(1, "jr", {"$ra"});
+// Procedures whose key is in the cache are copied from it. The others are
+// translated, on the pool if there is one, and added to it. Each procedure
+// starts with no procedure open, like after the .end of the one before, so
+// its text does not depend on what came before it. Without a cache or a
+// pool each procedure is translated straight into out.
+void translator::translate_procedures(index_range<block> blocks, vector<cached_procedure>& procedures,
+		const string& options, thread_pool* pool, emitter& out) {
+	size_t wave_size = pool != NULL && pool->size() > 1 ? 4 * pool->size() : 1;
+	if (cache == NULL && wave_size == 1) {
+		for (auto procedure = procedures.begin(); procedure != procedures.end(); procedure++) {
+			size_t slots = out.get_delay_slots(), filled = out.get_filled_slots();
+			translate_procedure(blocks.slice(procedure->first_block, procedure->last_block), out);
+			if (procedure->ends && scheduler != NULL) {
+				scheduler->record(procedure->name, out.get_delay_slots() - slots, out.get_filled_slots() - filled);
+			}
+		}
+		return;
+	}
 
-	return translated_inst;
+	for (size_t wave_begin = 0; wave_begin < procedures.size(); wave_begin += wave_size) {
+		size_t wave_end = min(procedures.size(), wave_begin + wave_size);
+		for (size_t p = wave_begin; p < wave_end; p++) {
+			cached_procedure* procedure = &procedures[p];
+			if (cache != NULL) {
+				procedure->key = cache_key(blocks.slice(procedure->first_block, procedure->last_block), options);
+				procedure->hit = cache->lookup(procedure->key, procedure->text, procedure->slots, procedure->filled);
+				if (procedure->hit) {
+					continue;
+				}
+			}
+			if (wave_size > 1) {
+				pool->submit([this, blocks, procedure] {
+					translate_cached_procedure(blocks.slice(procedure->first_block, procedure->last_block), *procedure);
+				});
+			} else {
+				translate_cached_procedure(blocks.slice(procedure->first_block, procedure->last_block), *procedure);
+			}
+		}
+		if (wave_size > 1) {
+			pool->wait();
+		}
+
+		for (size_t p = wave_begin; p < wave_end; p++) {
+			cached_procedure& procedure = procedures[p];
+			if (cache != NULL && !procedure.hit) {
+				cache->store(procedure.key, procedure.text, procedure.slots, procedure.filled);
+			}
+			out.append(procedure.text);
+			if (procedure.ends && scheduler != NULL) {
+				scheduler->record(procedure.name, procedure.slots, procedure.filled);
+			}
+			string().swap(procedure.key);
+			string().swap(procedure.text);
+		}
+	}
 }
 
-string translator::translate_call(instruction* inst) {
-	return instruction::to_string(1, "jal", {inst->get_operand1()});
+// the blocks up to each .end, and whatever follows the last one
+void translator::split_procedures(index_range<block> blocks, vector<cached_procedure>& procedures) {
+	bool is_procedure_head = true;
+	for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+		if (procedures.empty() || procedures.back().ends) {
+			cached_procedure procedure;
+			procedure.first_block = b_iter.get_index();
+			procedure.ends = false;
+			procedure.slots = procedure.filled = 0;
+			procedure.hit = false;
+			procedures.push_back(procedure);
+		}
+		cached_procedure& procedure = procedures.back();
+		text_ref label = b_iter->get_label();
+		if (!label.empty() && is_procedure_head) {
+			procedure.name = label;
+			is_procedure_head = false;
+		}
+		index_range<instruction> instructions = b_iter->get_instructions();
+		for (auto i_iter = instructions.begin(); i_iter != instructions.end(); i_iter++) {
+			is_procedure_head |= i_iter->get_opcode() == OP_LEAVE;
+		}
+		procedure.ends = !label.empty() && is_procedure_head;
+		procedure.last_block = b_iter.get_index() + 1;
+	}
 }
 
-string translator::translate_call_with_arguments(vector<instruction*> instructions, int argument_count) {
-	string translated_inst = "";
+// the blocks of one procedure, starting with no procedure open
+void translator::translate_procedure(index_range<block> blocks, emitter& out) {
+	bool is_procedure_head = true;
+	text_ref procedure_name;
+	for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+		translate_block_head(*b_iter, is_procedure_head, procedure_name, out);
+		if (translate_block(*b_iter, out)) {
+			is_procedure_head = true;
+		}
+		translate_block_end(*b_iter, is_procedure_head, procedure_name, out);
+	}
+}
 
-	int i = 0;
-	for (; i < argument_count; i++) {
-		translated_inst += translate_pushl(instructions[i]);
+// the procedures a walk from the entry label reaches, in the order it
+// reaches them: the entry's procedure first, then those its calls and jumps
+// go to. The others are skipped. Without the entry label nothing is
+// known to be dead and every procedure is kept
+void translator::reachable_procedures(parser& parser, vector<cached_procedure>& procedures,
+		vector<cached_procedure>& skipped) {
+	index_range<block> blocks = parser.get_code_blocks();
+	const unordered_map<string, int>& label_dic = parser.get_label_dic();
+	vector<cached_procedure> all;
+	split_procedures(blocks, all);
+	auto entry_label = label_dic.find(entry);
+	if (entry_label == label_dic.end()) {
+		procedures.swap(all);
+		return;
 	}
 
-	// last instruction is "call"
-	translated_inst += translate_call(instructions[i]);
+	vector<uint32_t> block_procedure(blocks.size());
+	for (size_t p = 0; p < all.size(); p++) {
+		for (uint32_t b = all[p].first_block; b < all[p].last_block; b++) {
+			block_procedure[b] = p;
+		}
+	}
+	vector<bool> reached(all.size(), false);
+	vector<uint32_t> order; // doubles as the worklist
+	order.push_back(block_procedure[entry_label->second]);
+	reached[order.back()] = true;
+	for (size_t next = 0; next < order.size(); next++) {
+		const cached_procedure& procedure = all[order[next]];
+		index_range<block> procedure_blocks = blocks.slice(procedure.first_block, procedure.last_block);
+		for (auto b_iter = procedure_blocks.begin(); b_iter != procedure_blocks.end(); b_iter++) {
+			index_range<instruction> instructions = b_iter->get_instructions();
+			for (auto i_iter = instructions.begin(); i_iter != instructions.end(); i_iter++) {
+				opcode_id op = i_iter->get_opcode();
+				if (op != OP_CALL && op != OP_JMP && !is_conditional_jump(op)) {
+					continue;
+				}
+				auto target = label_dic.find(i_iter->get_operand1().text.str());
+				if (target != label_dic.end() && !reached[block_procedure[target->second]]) {
+					reached[block_procedure[target->second]] = true;
+					order.push_back(block_procedure[target->second]);
+				}
+			}
+		}
+		// without an .end the code runs on into the next procedure
+		if (!procedure.ends && order[next] + 1 < all.size() && !reached[order[next] + 1]) {
+			reached[order[next] + 1] = true;
+			order.push_back(order[next] + 1);
+		}
+	}
 
-	translated_inst += instruction::to_string(1, "addi", {"$sp", "$sp", to_string(4 * argument_count)});
+	for (auto p = order.begin(); p != order.end(); p++) {
+		procedures.push_back(all[*p]);
+	}
+	for (size_t p = 0; p < all.size(); p++) {
+		if (!reached[p]) {
+			skipped.push_back(all[p]);
+		}
+	}
+}
 
-	return translated_inst;
+void translator::translate_cached_procedure(index_range<block> blocks, cached_procedure& procedure) {
+	ostringstream os;
+	{
+		emitter out(os);
+		out.set_optimizer(optimizer);
+		out.set_scheduler(scheduler);
+		translate_procedure(blocks, out);
+		procedure.slots = out.get_delay_slots();
+		procedure.filled = out.get_filled_slots();
+	}
+	procedure.text = os.str();
 }
 
-string translator::translate_prn(instruction* inst) {
-    string translated_inst = "";
-    translated_inst += instruction::to_string(1, "add", {"$a0", "$zero", registers_map[inst->get_operand1()]});
-    translated_inst += instruction::to_string(1, "li", {"$v0", "1"});
-    translated_inst += instruction::to_string(1, "syscall", {});
-    translated_inst += instruction::to_string(1, "li", {"$v0", "4"});
-    translated_inst += instruction::to_string(1, "la", {"$a0", "newline"});
-    translated_inst += instruction::to_string(1, "syscall", {});
-    return translated_inst;
+// everything besides the input that changes the translation, CODE_VERSION
+// standing in for the translator's own code. Streamed output decides
+// PRINT_AUTO per procedure rather than for the file
+string translator::cache_options(bool print_routine, bool streamed) {
+	ostringstream options;
+	options << "version " << CODE_VERSION
+		<< " print_routine " << print_routine
+		<< " streamed " << streamed
+		<< " peephole " << (optimizer != NULL ? optimizer->describe() : "off")
+		<< " noreorder " << (scheduler != NULL)
+		<< " liveness " << use_liveness
+		<< " instrument " << instrument
+		<< " promote " << promote
+		<< " reuse_addresses " << reuse_addresses << '\n';
+	return options.str();
 }
 
-string translator::translate_int(instruction* inst) {
-    string translated_inst = "";
-    translated_inst += instruction::to_string(1, "add", {"$a0", "$zero", registers_map["%ecx"]});
-    translated_inst += instruction::to_string(1, "li", {"$v0", "1"});
-    translated_inst += instruction::to_string(1, "syscall", {});
-    translated_inst += instruction::to_string(1, "li", {"$v0", "4"});
-    translated_inst += instruction::to_string(1, "la", {"$a0", "newline"});
-    translated_inst += instruction::to_string(1, "syscall", {});
-	return translated_inst;
+// the options and the procedure's input as the translator sees it: labels,
+// opcodes, operand texts and the registers live after each instruction
+string translator::cache_key(index_range<block> blocks, const string& options) {
+	string key = options;
+	for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+		text_ref label = b_iter->get_label();
+		key.append(label.data(), label.size());
+		key += ":\n";
+		index_range<instruction> instructions = b_iter->get_instructions();
+		for (auto i_iter = instructions.begin(); i_iter != instructions.end(); i_iter++) {
+			text_ref operand1 = i_iter->get_operand1().text;
+			text_ref operand2 = i_iter->get_operand2().text;
+			register_set live = i_iter->get_live_after();
+			key += (char) i_iter->get_opcode();
+			key.append(operand1.data(), operand1.size());
+			key += '\t';
+			key.append(operand2.data(), operand2.size());
+			key += '\t';
+			key += (char) (live & 0xff);
+			key += (char) (live >> 8);
+			key += '\n';
+		}
+	}
+	// the slots kept in registers, which jumps and calls elsewhere have a say in
+	for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+		index_range<instruction> instructions = b_iter->get_instructions();
+		if (instructions.begin() == instructions.end()) {
+			continue;
+		}
+		const frame_plan* plan = promoted_frame(*instructions.begin());
+		for (size_t s = 0; plan != NULL && s < plan->slots.size(); s++) {
+			key += to_string(plan->slots[s].displacement) + " " + promotion_registers[plan->slots[s].reg] + "\n";
+		}
+		break;
+	}
+	return key;
 }
 
-string translator::translate_pushl(instruction* inst) {
-	string operand = inst->get_operand1();
-	string immediate = operand.substr(1, operand.length()-1);
+template <void (translator::*translate)(instruction, emitter&)>
+void translator::dispatch_single(instruction_iter& iter, instruction_iter /*end*/, emitter& out) {
+	instruction instr = *iter;
+	iter++;
+	(this->*translate)(instr, out);
+}
 
-	string translated_inst = instruction::to_string(1, "addi", {"$sp", "$sp", "-4"});
+void translator::dispatch_pushl(instruction_iter& iter, instruction_iter end, emitter& out) {
+	operand_desc operand = iter->get_operand1();
+	if (operand.kind == OPERAND_REGISTER && operand.base == REG_EBP) {
+		// procedure head setup, pushl %ebp and movl %esp, %ebp
+		iter++;
+		instruction_iter setup = iter;
+		if (iter != end) {
+			iter++;
+		}
+		translate_procedure_head(out);
+		if (setup != end) {
+			translate_frame_setup(*setup, out);
+		}
+		return;
+	}
 
-	if (is_immediate(operand)) {
-		translated_inst += instruction::to_string(1, "li", {registers_map["temp"], immediate});
-		translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], "0($sp)"});
-	} else if (is_register(operand)) {
-		translated_inst += instruction::to_string(1, "sw", {registers_map[operand], "0($sp)"});
+	instruction_iter first = iter;
+	int argument_count = 0;
+
+	while (iter != end && iter->get_opcode() == OP_PUSHL) {
+		iter++;
+		argument_count++;
+	}
+
+	if (iter != end && iter->get_opcode() == OP_CALL) {
+		// procedure arguments
+		iter++;
+		translate_call_with_arguments(first, argument_count, out);
 	} else {
-		return WRONG_INSTRUCTION_MESG;
+		// normal pushl
+		translate_batch_pushl(first, iter, out);
 	}
-	return translated_inst;
 }
 
-string translator::translate_batch_pushl(vector<instruction*> instructions) {
-	string translated_inst = "";
-	for (auto iter = instructions.begin(); iter != instructions.end(); iter++) {
-		translated_inst += translate_pushl(*iter);
+void translator::dispatch_leave(instruction_iter& iter, instruction_iter end, emitter& out) {
+	// procedure end setup, leave and ret
+	translate_frame_restore(*iter, out);
+	iter++;
+	if (iter != end) {
+		iter++;
 	}
-	return translated_inst;
+	translate_procedure_end(out);
+}
+
+void translator::dispatch_cmpl(instruction_iter& iter, instruction_iter end, emitter& out) {
+	instruction cmpl_inst = *iter;
+	iter++;
+	if (iter == end) {
+		translate_wrong_instruction(out);
+		return;
+	}
+	instruction j_inst = *iter;
+	iter++;
+	translate_cmpl_j(cmpl_inst, j_inst, out);
+}
+
+void translator::dispatch_skip(instruction_iter& iter, instruction_iter /*end*/, emitter& /*out*/) {
+	// cltd needs no code, unknown instructions are dropped
+	iter++;
+}
+
+void translator::translate_procedure_head(emitter& out) {
+	out.emit(1, "addi", {"$sp", "$sp", "-8"});
+	out.emit(1, "sw", {"$ra", "4($sp)"});
+	out.emit(1, "sw", {"$fp", "0($sp)"});
+	out.emit(1, "addi", {"$fp", "$sp", "0"});
 }
 
-string translator::translate_popl(instruction* inst) {
-	string translated_inst = "";
-	translated_inst += instruction::to_string(1, "lw", {registers_map[inst->get_operand1()], "0($sp)"});
-	translated_inst += instruction::to_string(1, "addi", {"$sp", "$sp", "4"});
-	return translated_inst;
+void translator::translate_procedure_end(emitter& out) {
+	out.emit(1, "lw", {"$fp", "0($sp)"});
+	out.emit(1, "lw", {"$ra", "4($sp)"});
+	out.emit(1, "add", {"$sp", "$sp", "8"});
+	out.emit(1, "jr", {"$ra"});
 }
 
-string translator::translate_movl(instruction* inst) {
-    bool is_wrong_inst = false;
-    string translated_inst = "";
-	string operand1 = inst->get_operand1();
-	string operand2 = inst->get_operand2();
+/** block execution counters **/
+
+// the labels of the counters, one per labeled block in block order
+void translator::collect_counter_labels(index_range<block> blocks, vector<string>& labels) {
+	for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+		text_ref label = b_iter->get_label();
+		if (!label.empty()) {
+			labels.push_back(label.str());
+		}
+	}
+}
 
-    if (operand1 == "" || operand2 == "") {
-        is_wrong_inst = true;
+void translator::translate_data(emitter& out) {
+    // TODO translate .data
+    out.append(".data\n\tnewline: .asciiz \"\\n\"\n");
+}
+
+// the counters in block order after COUNTERS_LABEL, in the data section.
+// They are named after their block, so the code of a block does not depend
+// on where it is in the file
+void translator::translate_counters(const vector<string>& labels, emitter& out) {
+    out.append("\t.align 2\n");
+    out.append(SAVED_RA_LABEL); out.append(": .word 0\n");
+    out.append(COUNTERS_LABEL); out.append(":\n");
+    for (auto label = labels.begin(); label != labels.end(); label++) {
+        out.append('\t'); out.append(COUNTER_PREFIX); out.append(*label); out.append(": .word 0\n");
     }
+}
 
-    if (is_register(operand1)) { // first operand is register
-        if (is_register(operand2)) { // second operand is register
-			translated_inst += instruction::to_string(1, "add", {registers_map[operand2], registers_map["zero"], registers_map[operand1]});
-        } else if (is_indirect(operand2)) { // second operand is indirect
-			translated_inst += instruction::to_string(1, "sw", {registers_map[operand1], map_indirect(operand2)});
-		} else if (is_absolute(operand2)) {
-			string new_operand2 = address_absolute(translated_inst, operand2);
-			translated_inst += instruction::to_string(1, "sw", {registers_map[operand1], new_operand2});
-		} else if (is_indexed(operand2)) {
-			string new_operand2 = address_indexed(translated_inst, operand2);
-			translated_inst += instruction::to_string(1, "sw", {registers_map[operand1], new_operand2});
-		} else if (is_scaled_indexed(operand2)) {
-			string new_operand2 = address_scaled_indexed(translated_inst, operand2);
-			translated_inst += instruction::to_string(1, "sw", {registers_map[operand1], new_operand2});
-        } else {
-            is_wrong_inst = true;
-        }
-    } else if (is_immediate(operand1)) { // first operand is immediate
-        string immediate = map_immediate(operand1);
-
-        if (is_register(operand2)) { // second operand is register
-			translated_inst += instruction::to_string(1, "li", {registers_map[operand2], immediate});
-        } else if (is_indirect(operand2)) { // second operand is indirect
-			translated_inst += instruction::to_string(1, "li", {registers_map["temp"], immediate});
-			translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], map_indirect(operand2)});
-        } else if (is_absolute(operand2)) { 
-			string new_operand2 = address_absolute(translated_inst, operand2);
-			translated_inst += instruction::to_string(1, "li", {registers_map["temp"], immediate});
-			translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], new_operand2});
-        } else if (is_indexed(operand2)) {
-			string new_operand2 = address_indexed(translated_inst, operand2);
-			translated_inst += instruction::to_string(1, "li", {registers_map["temp"], immediate});
-			translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], new_operand2});
-        } else if (is_scaled_indexed(operand2)) {
-			string new_operand2 = address_scaled_indexed(translated_inst, operand2);
-			translated_inst += instruction::to_string(1, "li", {registers_map["temp"], immediate});
-			translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], new_operand2});
-        } else {
-            is_wrong_inst = true;
-        }
-    } else if (is_indirect(operand1)) { // first operand is address
-        if (is_register(operand2)) { // second operand is register
-			translated_inst += instruction::to_string(1, "lw", {registers_map[operand2], map_indirect(operand1)});
-        } else {
-            is_wrong_inst = true;
+// increments the block's counter, and in main makes the return go through
+// the dump routine first
+void translator::translate_block_counter(text_ref label, emitter& out) {
+    out.append("\tlw $s7, "); out.append(COUNTER_PREFIX); out.append(label); out.append('\n');
+    out.append("\taddi $s7, $s7, 1\n");
+    out.append("\tsw $s7, "); out.append(COUNTER_PREFIX); out.append(label); out.append('\n');
+    if (label == "main") {
+        out.append("\tsw $ra, "); out.append(SAVED_RA_LABEL); out.append('\n');
+        out.append("\tla $ra, "); out.append(DUMP_ROUTINE_LABEL); out.append('\n');
+    }
+}
+
+// prints every counter on a line of its own, in block order, and returns
+// to where main would have
+void translator::translate_dump_routine(size_t counter_count, emitter& out) {
+    out.append(DUMP_ROUTINE_LABEL); out.append(":\n");
+    out.emit(1, "la", {"$s6", COUNTERS_LABEL});
+    out.emit(1, "li", {"$s7", mips_operand::num(counter_count)});
+    out.append(DUMP_LOOP_LABEL); out.append(":\n");
+    out.emit(1, "lw", {"$a0", "0($s6)"});
+    out.emit(1, "li", {"$v0", "1"});
+    out.emit(1, "syscall", {});
+    out.emit(1, "li", {"$v0", "4"});
+    out.emit(1, "la", {"$a0", "newline"});
+    out.emit(1, "syscall", {});
+    out.emit(1, "addi", {"$s6", "$s6", "4"});
+    out.emit(1, "addi", {"$s7", "$s7", "-1"});
+    out.emit(1, "bne", {"$s7", "$zero", DUMP_LOOP_LABEL});
+    out.emit(1, "lw", {"$ra", SAVED_RA_LABEL});
+    out.emit(1, "jr", {"$ra"});
+    out.append('\n');
+}
+
+void translator::write_block_map(parser& parser, ostream& os, size_t first_index) {
+    index_range<block> blocks = parser.get_code_blocks();
+    size_t index = first_index;
+    for (auto b_iter = blocks.begin(); b_iter != blocks.end(); b_iter++) {
+        text_ref label = b_iter->get_label();
+        if (!label.empty()) {
+            os << index++ << '\t' << label.str() << '\t' << b_iter->get_line() << '\n';
         }
-    } else if (is_absolute(operand1)) { 
-        if (is_register(operand2)) { // second operand is register
-			string new_operand1 = address_absolute(translated_inst, operand1);
-			translated_inst += instruction::to_string(1, "lw", {registers_map[operand2], new_operand1});
+    }
+}
+
+/** promoted frame slots **/
+
+const frame_plan* translator::promoted_frame(instruction inst) {
+	return promote ? inst.get_program()->get_frame_plan(inst.get_index()) : NULL;
+}
+
+// the register holding the d(%ebp) slot of operand, NULL when it is in memory
+const string* translator::promoted_register(instruction inst, const operand_desc& operand) {
+	if (operand.kind != OPERAND_INDIRECT || operand.base != REG_EBP) {
+		return NULL;
+	}
+	const frame_plan* plan = promoted_frame(inst);
+	const promoted_slot* slot = plan != NULL ? plan->find(operand.displacement) : NULL;
+	return slot != NULL ? &promotion_registers[slot->reg] : NULL;
+}
+
+// after the frame and its locals are set up: the caller's values of the
+// callee-saved registers go to the slots they stand in for, and the
+// arguments are loaded
+void translator::translate_frame_setup(instruction inst, emitter& out) {
+	const frame_plan* plan = promoted_frame(inst);
+	if (plan == NULL || plan->setup_instruction != inst.get_index()) {
+		return;
+	}
+	for (auto slot = plan->slots.begin(); slot != plan->slots.end(); slot++) {
+		mips_operand home = mips_operand::memory(slot->displacement, registers_map[REG_EBP]);
+		if (slot->reg < frame_promotion::SAVED_REGISTERS) {
+			out.emit(1, "sw", {promotion_registers[slot->reg], home});
+		} else if (slot->argument) {
+			out.emit(1, "lw", {promotion_registers[slot->reg], home});
+		}
+	}
+}
+
+// at a leave, the callee-saved registers get the caller's values back, and
+// the locals are popped as leave's movl %ebp, %esp would: the procedure end
+// expects $sp where the frame setup left it
+void translator::translate_frame_restore(instruction inst, emitter& out) {
+	const frame_plan* plan = promoted_frame(inst);
+	if (plan == NULL) {
+		return;
+	}
+	for (auto slot = plan->slots.begin(); slot != plan->slots.end(); slot++) {
+		if (slot->reg < frame_promotion::SAVED_REGISTERS) {
+			out.emit(1, "lw", {promotion_registers[slot->reg], mips_operand::memory(slot->displacement, registers_map[REG_EBP])});
+		}
+	}
+	if (plan->frame_size > 0) {
+		out.emit(1, "addi", {registers_map[REG_ESP], registers_map[REG_EBP], "0"});
+	}
+}
+
+// the fallback for an instruction the translator has no form for
+void translator::translate_wrong_instruction(emitter& out) {
+	out.append(WRONG_INSTRUCTION_MESG);
+	if (stats != NULL) {
+		stats->add_wrong_instruction();
+	}
+}
+
+// promoted locals in caller-saved registers are stored around the call, and
+// those and the arguments loaded again after it
+void translator::translate_call(instruction inst, emitter& out) {
+	const frame_plan* plan = promoted_frame(inst);
+	for (size_t s = 0; plan != NULL && s < plan->slots.size(); s++) {
+		const promoted_slot& slot = plan->slots[s];
+		if (slot.reg >= frame_promotion::SAVED_REGISTERS && !slot.argument) {
+			out.emit(1, "sw", {promotion_registers[slot.reg], mips_operand::memory(slot.displacement, registers_map[REG_EBP])});
+		}
+	}
+	out.emit(1, "jal", {inst.get_operand1().text});
+	for (size_t s = 0; plan != NULL && s < plan->slots.size(); s++) {
+		const promoted_slot& slot = plan->slots[s];
+		if (slot.reg >= frame_promotion::SAVED_REGISTERS) {
+			out.emit(1, "lw", {promotion_registers[slot.reg], mips_operand::memory(slot.displacement, registers_map[REG_EBP])});
+		}
+	}
+}
+
+void translator::translate_call_with_arguments(instruction_iter first, int argument_count, emitter& out) {
+	int i = 0;
+	for (; i < argument_count; i++) {
+		translate_pushl(*(first + i), out);
+	}
+
+	// last instruction is "call"
+	translate_call(*(first + i), out);
+
+	out.emit(1, "addi", {"$sp", "$sp", mips_operand::num(4 * argument_count)});
+}
+
+void translator::translate_prn(instruction inst, emitter& out) {
+    translate_print(inst, registers_map[inst.get_operand1().base], out);
+}
+
+void translator::translate_int(instruction inst, emitter& out) {
+    translate_print(inst, registers_map[REG_ECX], out);
+}
+
+void translator::translate_print(instruction inst, const string& value_register, emitter& out) {
+    out.emit(1, "add", {"$a0", "$zero", value_register});
+    if (use_print_routine(*inst.get_program())) {
+        // returns through $v1, so $ra survives in procedures without a frame
+        out.emit(1, "la", {"$v0", PRINT_ROUTINE_LABEL});
+        out.emit(1, "jalr", {"$v1", "$v0"});
+        return;
+    }
+    out.emit(1, "li", {"$v0", "1"});
+    out.emit(1, "syscall", {});
+    out.emit(1, "li", {"$v0", "4"});
+    out.emit(1, "la", {"$a0", "newline"});
+    out.emit(1, "syscall", {});
+}
+
+// prints $a0 and a newline, called with jalr $v1
+void translator::translate_print_routine(emitter& out) {
+    out.append(PRINT_ROUTINE_LABEL); out.append(":\n");
+    out.emit(1, "li", {"$v0", "1"});
+    out.emit(1, "syscall", {});
+    out.emit(1, "li", {"$v0", "4"});
+    out.emit(1, "la", {"$a0", "newline"});
+    out.emit(1, "syscall", {});
+    out.emit(1, "jr", {"$v1"});
+    out.append('\n');
+}
+
+// decided from the whole program, so every call site agrees with the preamble
+bool translator::use_print_routine(const program& prog) {
+    if (print != PRINT_AUTO) {
+        return print == PRINT_CALL;
+    }
+    size_t sites = prog.opcode_count(OP_PRN) + prog.opcode_count(OP_INT);
+    return sites * CALL_PRINT_SIZE + PRINT_ROUTINE_SIZE < sites * INLINE_PRINT_SIZE;
+}
+
+void translator::translate_pushl(instruction inst, emitter& out) {
+	const operand_desc& operand = inst.get_operand1();
+
+	if (operand.kind == OPERAND_IMMEDIATE) {
+		out.emit(1, "addi", {"$sp", "$sp", "-4"});
+		out.emit(1, "li", {registers_map[REG_TEMP], map_immediate(operand)});
+		out.emit(1, "sw", {registers_map[REG_TEMP], "0($sp)"});
+	} else if (operand.kind == OPERAND_REGISTER) {
+		out.emit(1, "addi", {"$sp", "$sp", "-4"});
+		out.emit(1, "sw", {registers_map[operand.base], "0($sp)"});
+	} else {
+		translate_wrong_instruction(out);
+	}
+}
+
+void translator::translate_batch_pushl(instruction_iter first, instruction_iter last, emitter& out) {
+	for (auto iter = first; iter != last; iter++) {
+		translate_pushl(*iter, out);
+	}
+}
+
+void translator::translate_popl(instruction inst, emitter& out) {
+	out.emit(1, "lw", {registers_map[inst.get_operand1().base], "0($sp)"});
+	out.emit(1, "addi", {"$sp", "$sp", "4"});
+}
+
+void translator::translate_movl(instruction inst, emitter& out) {
+	const operand_desc& operand1 = inst.get_operand1();
+	const operand_desc& operand2 = inst.get_operand2();
+
+    if (operand1.kind == OPERAND_REGISTER) { // first operand is register
+        if (operand2.kind == OPERAND_REGISTER) { // second operand is register
+			out.emit(1, "add", {registers_map[operand2.base], registers_map[REG_ZERO], registers_map[operand1.base]});
+        } else if (const string* promoted = promoted_register(inst, operand2)) {
+			out.emit(1, "add", {*promoted, registers_map[REG_ZERO], registers_map[operand1.base]});
+        } else if (operand2.is_memory()) { // second operand is memory
+			mips_operand new_operand2 = address_memory(inst, out, operand2);
+			out.emit(1, "sw", {registers_map[operand1.base], new_operand2});
         } else {
-            is_wrong_inst = true;
+            translate_wrong_instruction(out);
         }
-    } else if (is_indexed(operand1)) { 
-        if (is_register(operand2)) { // second operand is register
-			string new_operand1 = address_indexed(translated_inst, operand1);
-			translated_inst += instruction::to_string(1, "lw", {registers_map[operand2], new_operand1});
+    } else if (operand1.kind == OPERAND_IMMEDIATE) { // first operand is immediate
+        mips_operand immediate = map_immediate(operand1);
+
+        if (operand2.kind == OPERAND_REGISTER) { // second operand is register
+			out.emit(1, "li", {registers_map[operand2.base], immediate});
+        } else if (const string* promoted = promoted_register(inst, operand2)) {
+			out.emit(1, "li", {*promoted, immediate});
+        } else if (operand2.is_memory()) { // second operand is memory
+			mips_operand new_operand2 = address_memory(inst, out, operand2);
+			out.emit(1, "li", {registers_map[REG_TEMP], immediate});
+			out.emit(1, "sw", {registers_map[REG_TEMP], new_operand2});
         } else {
-            is_wrong_inst = true;
+            translate_wrong_instruction(out);
         }
-    } else if (is_scaled_indexed(operand1)) { 
-        if (is_register(operand2)) { // second operand is register
-			string new_operand1 = address_scaled_indexed(translated_inst, operand1);
-			translated_inst += instruction::to_string(1, "lw", {registers_map[operand2], new_operand1});
+    } else if (operand1.is_memory()) { // first operand is memory
+        const string* promoted = promoted_register(inst, operand1);
+        if (promoted != NULL && operand2.kind == OPERAND_REGISTER) {
+			out.emit(1, "add", {registers_map[operand2.base], registers_map[REG_ZERO], *promoted});
+        } else if (operand2.kind == OPERAND_REGISTER) { // second operand is register
+			mips_operand new_operand1 = address_memory(inst, out, operand1);
+			out.emit(1, "lw", {registers_map[operand2.base], new_operand1});
         } else {
-            is_wrong_inst = true;
+            translate_wrong_instruction(out);
         }
     } else {
-        is_wrong_inst = true;
-    }
-    if (is_wrong_inst) {
-        return WRONG_INSTRUCTION_MESG;
-    }
-    return translated_inst;
-}
-
-string translator::translate_addl_andl_xorl_orl(instruction* inst) {
-    string op = inst -> get_op();
-    op = op.substr(0, op.length()-1);
-    string operand1 = inst -> get_operand1();
-    string operand2 = inst -> get_operand2();
-
-    if (is_register(operand1) && is_register(operand2)) { 
-		return instruction::to_string(1, op, {registers_map[operand2], registers_map[operand2], registers_map[operand1]});
-    } else if (is_immediate(operand1)) {  
-        string immediate = map_immediate(operand1);
-        if (is_register(operand2)) { // second operand is register
-			return instruction::to_string(1, op + "i", {registers_map[operand2], registers_map[operand2], immediate});
-        } else if (is_indirect(operand2)) { // second operand is address
-			string new_operand2 = map_indirect(operand2);
-			string translated_inst;
-			translated_inst += instruction::to_string(1, op, {registers_map["temp"], registers_map["zero"], immediate});
-			translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], new_operand2});
-			return translated_inst;
+        translate_wrong_instruction(out);
+    }
+}
+
+void translator::translate_addl_andl_xorl_orl(instruction inst, emitter& out) {
+    const char* op;
+    const char* op_immediate;
+    switch (inst.get_opcode()) {
+        case OP_ADDL: op = "add"; op_immediate = "addi"; break;
+        case OP_ANDL: op = "and"; op_immediate = "andi"; break;
+        case OP_XORL: op = "xor"; op_immediate = "xori"; break;
+        default: op = "or"; op_immediate = "ori"; break;
+    }
+    const operand_desc& operand1 = inst.get_operand1();
+    const operand_desc& operand2 = inst.get_operand2();
+
+    if (operand1.kind == OPERAND_REGISTER && operand2.kind == OPERAND_REGISTER) { 
+		out.emit(1, op, {registers_map[operand2.base], registers_map[operand2.base], registers_map[operand1.base]});
+    } else if (operand1.kind == OPERAND_IMMEDIATE) {  
+        mips_operand immediate = map_immediate(operand1);
+        if (operand2.kind == OPERAND_REGISTER) { // second operand is register
+			out.emit(1, op_immediate, {registers_map[operand2.base], registers_map[operand2.base], immediate});
+        } else if (const string* promoted = promoted_register(inst, operand2)) { // a promoted slot, read and written
+			out.emit(1, op_immediate, {*promoted, *promoted, immediate});
+        } else if (operand2.kind == OPERAND_INDIRECT) { // second operand is address
+			mips_operand new_operand2 = map_indirect(operand2);
+			out.emit(1, op, {registers_map[REG_TEMP], registers_map[REG_ZERO], immediate});
+			out.emit(1, "sw", {registers_map[REG_TEMP], new_operand2});
         } else {
-			return WRONG_INSTRUCTION_MESG;
+			translate_wrong_instruction(out);
         }
-    } else if (is_indirect(operand1) && is_register(operand2)) { 
-		string new_operand1 = map_indirect(operand1);
-		string translated_inst;
-		translated_inst += instruction::to_string(1, "lw", {registers_map["temp"], new_operand1});
-		translated_inst += instruction::to_string(1, op, {registers_map[operand2], registers_map[operand2], registers_map["temp"]});
-		return translated_inst;
+    } else if (operand1.kind == OPERAND_INDIRECT && operand2.kind == OPERAND_REGISTER) { 
+		const string* source = promoted_register(inst, operand1);
+		if (source == NULL) {
+			mips_operand new_operand1 = map_indirect(operand1);
+			out.emit(1, "lw", {registers_map[REG_TEMP], new_operand1});
+			source = &registers_map[REG_TEMP];
+		}
+		out.emit(1, op, {registers_map[operand2.base], registers_map[operand2.base], *source});
 	} else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_subl(instruction* inst) {
-    string translated_inst;
-	string operand1 = inst->get_operand1();
-	string operand2 = inst->get_operand2();
-    if (is_register(operand1) && is_register(operand2)) { 
-		return instruction::to_string(1, "sub", {registers_map[operand2], registers_map[operand2], registers_map[operand1]});
-    } else if (is_immediate(operand1) && is_register(operand2)) {
-        string immediate = map_immediate(operand1);
-		if (immediate.at(0) == '-') {
-			immediate = immediate.substr(1, immediate.length() - 1 );
-		} else {
-			immediate = "-" + immediate;
+void translator::translate_subl(instruction inst, emitter& out) {
+	const operand_desc& operand1 = inst.get_operand1();
+	const operand_desc& operand2 = inst.get_operand2();
+    if (operand1.kind == OPERAND_REGISTER && operand2.kind == OPERAND_REGISTER) { 
+		out.emit(1, "sub", {registers_map[operand2.base], registers_map[operand2.base], registers_map[operand1.base]});
+    } else if (operand1.kind == OPERAND_IMMEDIATE && operand2.kind == OPERAND_REGISTER) {
+        text_ref immediate = operand1.value_text;
+        mips_operand negated_immediate = mips_operand::negated(immediate);
+		if (!immediate.empty() && immediate[0] == '-') {
+			negated_immediate = mips_operand(text_ref(immediate.begin() + 1, immediate.end()));
 		}
-		return instruction::to_string(1, "addi", {registers_map[operand2], registers_map[operand2], immediate});
-    } else {
-        return WRONG_INSTRUCTION_MESG;
-    }
-}
-
-string translator::translate_imull(instruction* inst) {
-	string operand1 = inst->get_operand1();
-	string operand2 = inst->get_operand2();
-	string translated_inst = "";
-    if (is_register(operand1) && is_register(operand2)) { 
-		translated_inst += instruction::to_string(1, "mult", {registers_map[operand1], registers_map[operand2]});
-		translated_inst += instruction::to_string(1, "mflo", {registers_map[operand2]});
-		return translated_inst;
-    } else if (is_immediate(operand1) && is_register(operand2)) { 
-		string immediate = map_immediate(operand1);
-		string temp_register = "$s6";
-		translated_inst += instruction::to_string(1, "addi", {temp_register, registers_map["zero"], immediate});
-		translated_inst += instruction::to_string(1, "mult", {temp_register, registers_map[operand2]});
-		translated_inst += instruction::to_string(1, "mflo", {registers_map[operand2]});
+		out.emit(1, "addi", {registers_map[operand2.base], registers_map[operand2.base], negated_immediate});
+		translate_frame_setup(inst, out);
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_idivl(instruction* inst) {
-    string operand = inst->get_operand1();
-    string translated_inst = "";
-    if (is_register(operand)) {
-        translated_inst += instruction::to_string(1, "div", {registers_map["%eax"], registers_map[operand]});
-        translated_inst += instruction::to_string(1, "mflo", {registers_map["%eax"]});
-        translated_inst += instruction::to_string(1, "mfhi", {registers_map["%edx"]});
+void translator::translate_imull(instruction inst, emitter& out) {
+	const operand_desc& operand1 = inst.get_operand1();
+	const operand_desc& operand2 = inst.get_operand2();
+    if (operand1.kind == OPERAND_REGISTER && operand2.kind == OPERAND_REGISTER) { 
+		out.emit(1, "mult", {registers_map[operand1.base], registers_map[operand2.base]});
+		out.emit(1, "mflo", {registers_map[operand2.base]});
+    } else if (operand1.kind == OPERAND_IMMEDIATE && operand2.kind == OPERAND_REGISTER) { 
+		const string& temp_register = registers_map[REG_ADDRESSING_RESULT];
+		if (is_number(operand1.value_text)) { // constant, shifts and adds where possible
+			emit_multiply(out, registers_map[operand2.base], registers_map[operand2.base], operand1.immediate, temp_register);
+			return;
+		}
+		mips_operand immediate = map_immediate(operand1);
+		out.emit(1, "addi", {temp_register, registers_map[REG_ZERO], immediate});
+		out.emit(1, "mult", {temp_register, registers_map[operand2.base]});
+		out.emit(1, "mflo", {registers_map[operand2.base]});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
-    return translated_inst;
 }
 
-string translator::translate_sall_or_shll(instruction* inst) {
-	string operand1 = inst->get_operand1();
-	string operand2 = inst->get_operand2();
-    if (is_register(operand1) && is_register(operand2)) { 
-		return instruction::to_string(1, "sllv", {registers_map[operand2], registers_map[operand2], registers_map[operand1]});
-    } else if (is_immediate(operand1) && is_register(operand2)) {  
-		return instruction::to_string(1, "sll", {registers_map[operand2], registers_map[operand2], map_immediate(operand1)});
+void translator::translate_idivl(instruction inst, emitter& out) {
+    const operand_desc& operand = inst.get_operand1();
+    if (operand.kind == OPERAND_REGISTER) {
+        out.emit(1, "div", {registers_map[REG_EAX], registers_map[operand.base]});
+        // the quotient and the remainder only when they are read
+        if (inst.is_live_after(REG_EAX)) {
+            out.emit(1, "mflo", {registers_map[REG_EAX]});
+        }
+        if (inst.is_live_after(REG_EDX)) {
+            out.emit(1, "mfhi", {registers_map[REG_EDX]});
+        }
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_sarl(instruction* inst) {
-	string operand1 = inst->get_operand1();
-	string operand2 = inst->get_operand2();
-    if (is_immediate(operand1) && is_register(operand2)) { 
-		string immediate = map_immediate(operand1);
-		return instruction::to_string(1, "sra", {registers_map[operand2], registers_map[operand2], immediate});
+void translator::translate_sall_or_shll(instruction inst, emitter& out) {
+	const operand_desc& operand1 = inst.get_operand1();
+	const operand_desc& operand2 = inst.get_operand2();
+    if (operand1.kind == OPERAND_REGISTER && operand2.kind == OPERAND_REGISTER) { 
+		out.emit(1, "sllv", {registers_map[operand2.base], registers_map[operand2.base], registers_map[operand1.base]});
+    } else if (operand1.kind == OPERAND_IMMEDIATE && operand2.kind == OPERAND_REGISTER) {  
+		out.emit(1, "sll", {registers_map[operand2.base], registers_map[operand2.base], map_immediate(operand1)});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_shrl(instruction* inst) {
-	string operand1 = inst->get_operand1();
-	string operand2 = inst->get_operand2();
-    if (is_immediate(operand1) && is_register(operand2)) {
-		string immediate = map_immediate(operand1);
-		return instruction::to_string(1, "srl", {registers_map[operand2], registers_map[operand2], immediate});
+void translator::translate_sarl(instruction inst, emitter& out) {
+	const operand_desc& operand1 = inst.get_operand1();
+	const operand_desc& operand2 = inst.get_operand2();
+    if (operand1.kind == OPERAND_IMMEDIATE && operand2.kind == OPERAND_REGISTER) { 
+		out.emit(1, "sra", {registers_map[operand2.base], registers_map[operand2.base], map_immediate(operand1)});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_incl(instruction* inst) {
-	string operand = inst->get_operand1();
-    if (is_register(operand)) { // first operand is register
-		return instruction::to_string(1, "addi", {registers_map[operand], registers_map[operand], "1"});
+void translator::translate_shrl(instruction inst, emitter& out) {
+	const operand_desc& operand1 = inst.get_operand1();
+	const operand_desc& operand2 = inst.get_operand2();
+    if (operand1.kind == OPERAND_IMMEDIATE && operand2.kind == OPERAND_REGISTER) {
+		out.emit(1, "srl", {registers_map[operand2.base], registers_map[operand2.base], map_immediate(operand1)});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_decl(instruction* inst) {
-	string operand = inst->get_operand1();
-    if (is_register(operand)) { // first operand is register
-		return instruction::to_string(1, "addi", {registers_map[operand], registers_map[operand], "-1"});
-    } else if (is_indirect(operand)) {
-        string new_operand = map_indirect(operand);
-        string translated_inst;
-        translated_inst += instruction::to_string(1, "lw", {registers_map["temp"], new_operand});
-        translated_inst += instruction::to_string(1, "addi", {registers_map["temp"], registers_map["temp"], "-1"});
-        translated_inst += instruction::to_string(1, "sw", {registers_map["temp"], new_operand});
-        return translated_inst;
+void translator::translate_incl(instruction inst, emitter& out) {
+	const operand_desc& operand = inst.get_operand1();
+    if (operand.kind == OPERAND_REGISTER) { // first operand is register
+		out.emit(1, "addi", {registers_map[operand.base], registers_map[operand.base], "1"});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_negl(instruction* inst) {
-	string operand = inst->get_operand1();
-    if (is_register(operand)) { // first operand is register
-		return instruction::to_string(1, "sub", {registers_map[operand], registers_map["zero"], registers_map[operand]});
+void translator::translate_decl(instruction inst, emitter& out) {
+	const operand_desc& operand = inst.get_operand1();
+    if (operand.kind == OPERAND_REGISTER) { // first operand is register
+		out.emit(1, "addi", {registers_map[operand.base], registers_map[operand.base], "-1"});
+    } else if (const string* promoted = promoted_register(inst, operand)) {
+        out.emit(1, "addi", {*promoted, *promoted, "-1"});
+    } else if (operand.kind == OPERAND_INDIRECT) {
+        mips_operand new_operand = map_indirect(operand);
+        out.emit(1, "lw", {registers_map[REG_TEMP], new_operand});
+        out.emit(1, "addi", {registers_map[REG_TEMP], registers_map[REG_TEMP], "-1"});
+        out.emit(1, "sw", {registers_map[REG_TEMP], new_operand});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_notl(instruction* inst) {
-	string operand = inst->get_operand1();
-    if (is_register(operand)) { // first operand is register
-		return instruction::to_string(1, "not", {registers_map[operand], registers_map[operand]});
+void translator::translate_negl(instruction inst, emitter& out) {
+	const operand_desc& operand = inst.get_operand1();
+    if (operand.kind == OPERAND_REGISTER) { // first operand is register
+		out.emit(1, "sub", {registers_map[operand.base], registers_map[REG_ZERO], registers_map[operand.base]});
     } else {
-        return WRONG_INSTRUCTION_MESG;
+        translate_wrong_instruction(out);
     }
 }
 
-string translator::translate_jmp(instruction* inst) {
-	return instruction::to_string(1, "b", {inst->get_operand1()});
+void translator::translate_notl(instruction inst, emitter& out) {
+	const operand_desc& operand = inst.get_operand1();
+    if (operand.kind == OPERAND_REGISTER) { // first operand is register
+		out.emit(1, "not", {registers_map[operand.base], registers_map[operand.base]});
+    } else {
+        translate_wrong_instruction(out);
+    }
 }
 
-string translator::translate_cmpl_j(instruction* cmpl_inst, instruction* j_inst) {
-	string Rsrc1 = cmpl_inst->get_operand2();
-    string src2 = cmpl_inst->get_operand1();
-    if (is_register(Rsrc1)) { // register
-        Rsrc1 = registers_map[Rsrc1];
-    } else if (is_immediate(Rsrc1)) { // immediate
-        Rsrc1 = map_immediate(Rsrc1);
-    }
-	if (is_register(src2)) { // register
-        src2 = registers_map[src2];
-    } else if (is_immediate(src2)) { // immediate
-		src2 = map_immediate(src2);
-    }
-    string j_label = j_inst->get_operand1();
-	string j_op = j_inst->get_op();
-	string translated_inst = "";
+void translator::translate_jmp(instruction inst, emitter& out) {
+	out.emit(1, "b", {inst.get_operand1().text});
+}
 
-	if (j_op == "je") {
-		translated_inst += instruction::to_string(1, "beq", {Rsrc1, src2, j_label});
-	} else if (j_op == "jne") {
-		translated_inst += instruction::to_string(1, "bne", {Rsrc1, src2, j_label});
-	} else if (j_op == "jl") {
-		translated_inst += instruction::to_string(1, "blt", {Rsrc1, src2, j_label});
-	} else if (j_op == "jle") {
-		translated_inst += instruction::to_string(1, "ble", {Rsrc1, src2, j_label});
-	} else if (j_op == "jg") {
-		translated_inst += instruction::to_string(1, "bgt", {Rsrc1, src2, j_label});
-	} else if (j_op == "jge") {
-		translated_inst += instruction::to_string(1, "bge", {Rsrc1, src2, j_label});
+void translator::translate_cmpl_j(instruction cmpl_inst, instruction j_inst, emitter& out) {
+	mips_operand Rsrc1 = map_compare_operand(cmpl_inst, cmpl_inst.get_operand2());
+    mips_operand src2 = map_compare_operand(cmpl_inst, cmpl_inst.get_operand1());
+    text_ref j_label = j_inst.get_operand1().text;
+
+	switch (j_inst.get_opcode()) {
+		case OP_JE: out.emit(1, "beq", {Rsrc1, src2, j_label}); break;
+		case OP_JNE: out.emit(1, "bne", {Rsrc1, src2, j_label}); break;
+		case OP_JL: out.emit(1, "blt", {Rsrc1, src2, j_label}); break;
+		case OP_JLE: out.emit(1, "ble", {Rsrc1, src2, j_label}); break;
+		case OP_JG: out.emit(1, "bgt", {Rsrc1, src2, j_label}); break;
+		case OP_JGE: out.emit(1, "bge", {Rsrc1, src2, j_label}); break;
+		default: break;
 	}
 
-	return translated_inst += "\n";
-}
-
-bool translator::is_immediate(string operand) {
-	return operand.size() > 0 && operand.at(0) == '$';
+	out.blank_line();
 }
 
-bool translator::is_register(string operand) {
-	return operand.size() > 0 && operand.at(0) == '%';
-}
 
-bool translator::is_absolute(string operand) {
-	return all_of(operand.begin(), operand.end(), ::isdigit); 
+mips_operand translator::address_memory(instruction inst, emitter& out, const operand_desc& operand) {
+	switch (operand.kind) {
+		case OPERAND_INDIRECT: return map_indirect(operand);
+		case OPERAND_ABSOLUTE: return address_absolute(out, operand);
+		case OPERAND_INDEXED: return address_indexed(inst, out, operand);
+		default: return address_scaled_indexed(inst, out, operand);
+	}
 }
 
-bool translator::is_indirect(string operand) {
-	return operand.find('(') != string::npos
-		&& operand.find(')') != string::npos
-		&& operand.find(',') == string::npos;
+mips_operand translator::address_absolute(emitter& out, const operand_desc& operand) {
+	const string& result_register = registers_map[REG_ADDRESSING_RESULT];
+	out.emit(1, "addi", {result_register, registers_map[REG_ZERO], operand.value_text});
+	return mips_operand::memory("", result_register);
 }
 
-bool translator::is_indexed(string operand) {
-	int comma_count = 0;
-	for (char c : operand) {
-		if (c == ',') {
-			comma_count++;
-		}
+mips_operand translator::address_indexed(instruction inst, emitter& out, const operand_desc& operand) {
+	text_ref imm = operand.value_text.empty() ? text_ref("0") : operand.value_text;
+	address_use use = inst.get_address_use();
+	const string& result_register = address_registers[use.reg];
+	if (!use.computed) {
+		return mips_operand::memory(imm, result_register);
 	}
-	return comma_count == 1
-		&& operand.find('(') != string::npos
-		&& operand.find(')') != string::npos;
+
+	out.emit(1, "add", {result_register, registers_map[operand.base], registers_map[operand.index]});
+
+	return mips_operand::memory(imm, result_register);
 }
 
-bool translator::is_scaled_indexed(string operand) {
-	int comma_count = 0;
-	for (char c : operand) {
-		if (c == ',') {
-			comma_count++;
+mips_operand translator::address_scaled_indexed(instruction inst, emitter& out, const operand_desc& operand) {
+	text_ref imm = operand.value_text.empty() ? text_ref("0") : operand.value_text;
+	const string& index = registers_map[operand.index];
+	address_use use = inst.get_address_use();
+	const string& result_register = address_registers[use.reg];
+
+	if (operand.scale == 1) {
+		if (operand.base == REG_NONE) {
+			return mips_operand::memory(imm, index);
+		}
+		if (!use.computed) {
+			return mips_operand::memory(imm, result_register);
 		}
+		out.emit(1, "addu", {result_register, index, registers_map[operand.base]});
+		return mips_operand::memory(imm, result_register);
 	}
-	return comma_count == 2
-		&& operand.find('(') != string::npos
-		&& operand.find(')') != string::npos;
-}
 
+	if (!use.computed) {
+		return mips_operand::memory(imm, result_register);
+	}
+	// the scales 2, 4 and 8 become one sll
+	emit_multiply(out, result_register, index, operand.scale, result_register);
+	if (operand.base != REG_NONE) {
+		out.emit(1, "addu", {result_register, result_register, registers_map[operand.base]});
+	}
 
-string translator::address_absolute(string& translated_insts, string operand) {
-	string result_register = registers_map["addressing_result"];
-	translated_insts += instruction::to_string(1, "addi", {result_register, registers_map["zero"], operand});
-	return "(" + result_register + ")";
+	return mips_operand::memory(imm, result_register);
 }
 
-string translator::address_indexed(string& translated_insts, string operand) {
-	operand.erase( remove_if( operand.begin(), operand.end(), ::isspace ), operand.end() );
-
-	size_t i = operand.find('(');
-	size_t j = operand.find(')');
+mips_operand translator::map_indirect(const operand_desc& operand) {
+	return mips_operand::memory(operand.value_text, registers_map[operand.base]);
+}
 
-	string imm = operand.substr(0, i);
-	string paren_content = operand.substr(i+1, j-i-1);
+mips_operand translator::map_immediate(const operand_desc& operand) {
+    return mips_operand(operand.value_text);
+}
 
-	string reg1, reg2;
-	istringstream ss(paren_content);
-	getline(ss, reg1, ',');
-	getline(ss, reg2, ',');
-	if (imm.empty()) {
-		imm = "0";
+mips_operand translator::map_compare_operand(instruction inst, const operand_desc& operand) {
+	if (operand.kind == OPERAND_REGISTER) { // register
+		return registers_map[operand.base];
+	} else if (operand.kind == OPERAND_IMMEDIATE) { // immediate
+		return map_immediate(operand);
+	} else if (const string* promoted = promoted_register(inst, operand)) {
+		return *promoted;
 	}
-	string result_register = registers_map["addressing_result"];
-	string new_operand = imm + "(" + result_register + ")";
-
-	translated_insts += instruction::to_string(1, "add", {result_register, registers_map[reg1], registers_map[reg2]});
+	return operand.text;
+}
 
-	return new_operand;
+void translator::set_optimizer(peephole* optimizer) {
+	this->optimizer = optimizer;
 }
 
-string translator::address_scaled_indexed(string& translated_insts, string operand) {
-	operand.erase( remove_if( operand.begin(), operand.end(), ::isspace ), operand.end() );
+void translator::set_print_mode(print_mode mode) {
+	print = mode;
+}
 
-	size_t i = operand.find('(');
-	size_t j = operand.find(')');
+void translator::set_scheduler(delay_slot_scheduler* scheduler) {
+	this->scheduler = scheduler;
+}
 
-	string imm1 = operand.substr(0, i);
-	string paren_content = operand.substr(i+1, j-i-1);
+void translator::set_liveness(bool enabled) {
+	use_liveness = enabled;
+}
 
-	string reg1, reg2, imm2;
-	istringstream ss(paren_content);
-	getline(ss, reg1, ',');
-	getline(ss, reg2, ',');
-	getline(ss, imm2, ',');
+void translator::set_cache(translation_cache* cache) {
+	this->cache = cache;
+}
 
-	if (imm1.empty()) {
-		imm1 = "0";
-	}
-	if (reg1.empty()) {
-		reg1 = registers_map["zero"];
-	} else {
-		reg1 = registers_map[reg1];
-	}
-	string result_register = registers_map["addressing_result"];
-	string new_operand = imm1 + "(" + result_register + ")";
+void translator::set_entry(const string& label) {
+	entry = label;
+}
 
-	translated_insts += instruction::to_string(1, "addi", {result_register, registers_map["zero"], imm2});
-	translated_insts += instruction::to_string(1, "mult", {result_register, registers_map[reg2]});
-	translated_insts += instruction::to_string(1, "mflo", {result_register});
-	translated_insts += instruction::to_string(1, "add", {result_register, result_register, reg1});
+void translator::set_stats(translation_stats* stats) {
+	this->stats = stats;
+}
 
-	return new_operand;
+void translator::set_instrument(bool enabled) {
+	instrument = enabled;
 }
 
-string translator::map_indirect(string operand) {
-	size_t i = operand.find("(");
-	size_t j = operand.find(")");
-	string offset = operand.substr(0, i);
-	string dst_register = operand.substr(i+1, j-i-1);
-	string new_operand = offset + "(" + registers_map[dst_register] + ")";
+void translator::set_promotion(bool enabled) {
+	promote = enabled;
+}
 
-	return new_operand;
+void translator::set_address_reuse(bool enabled) {
+	reuse_addresses = enabled;
 }
 
-string translator::map_immediate(string operand) {
-    return operand.substr(1, operand.size() - 1);
+bool translator::get_instrument() const {
+	return instrument;
 }
 
-translator::~translator() {
-    registers_map.clear();
+translation_stats* translator::get_stats() const {
+	return stats;
 }
+
+translator::~translator() {}
@@ -6,62 +6,237 @@
 #include <vector>
 #include <ctype.h>
 #include "parser.h"
+#include "opcode.h"
+#include "emitter.h"
+#include "thread_pool.h"
+#include "peephole.h"
+#include "delay_slot.h"
+#include "cache.h"
+#include "stats.h"
+#include "promotion.h"
+#include "addressing.h"
 #include <initializer_list>
 
 
 using namespace std;
 
 class translator {
+public:
+    // how prn and int print their register
+    enum print_mode {
+        PRINT_INLINE, // the print syscalls at every call site
+        PRINT_CALL,   // a call to one shared routine emitted ahead of the code
+        PRINT_AUTO    // whichever gives the smaller code for the program
+    };
+    // smaller inputs are not worth starting a pool for unless --jobs asks,
+    // they fill fewer than two runs of MIN_RANGE_INSTRUCTIONS
+    static const size_t MIN_PARALLEL_INSTRUCTIONS = 8192;
+
 private:
-    unordered_map<string, string> registers_map;
+    typedef index_range<instruction>::iterator instruction_iter;
+    // consumes one or more instructions starting at iter and emits their translation
+    typedef void (translator::*translate_handler)(instruction_iter& iter, instruction_iter end, emitter& out);
+
+    // filled in by the constructor and only read afterwards, which is what
+    // lets several threads translate with the same translator
+    string registers_map[REG_COUNT];
+    string promotion_registers[frame_promotion::REGISTER_COUNT];
+    string address_registers[address_reuse::REGISTER_COUNT];
+    translate_handler dispatch_table[OP_COUNT];
+
+    // code of a run of blocks translated by a worker thread
+    struct translated_range {
+        uint32_t first_block;
+        uint32_t last_block;
+        string text;
+        vector<size_t> block_ends; // offset in text where the code of each block ends
+        vector<bool> block_leaves; // whether each block left its procedure
+        vector<size_t> block_slots; // delay slots scheduled up to the end of each block
+        vector<size_t> block_filled;
+    };
+    // a range is closed at the first procedure end after this many instructions
+    static const size_t MIN_RANGE_INSTRUCTIONS = 4096;
+
+    // part of every cache key; bump it with any change to the code generated
+    // for the same input and options, wherever it is made (translator,
+    // strength, emitter, peephole, delay_slot, liveness, promotion,
+    // addressing), so entries written before it no longer match
+    static const int CODE_VERSION = 2;
+
+    // the blocks of one procedure, up to the block that writes its .end,
+    // which is the unit the translation cache stores and reachability keeps or skips
+    struct cached_procedure {
+        uint32_t first_block;
+        uint32_t last_block;
+        text_ref name; // for the delay slot report
+        bool ends;     // whether the last block writes .end
+        string key;
+        string text;
+        size_t slots;
+        size_t filled;
+        bool hit;
+    };
+
+	// rewrites the generated code when set, shared by all emitters
+	peephole* optimizer;
+	// fills branch delay slots for .set noreorder output when set
+	delay_slot_scheduler* scheduler;
+	// procedures translated before are taken from here when set
+	translation_cache* cache;
+	// counts what is translated when set
+	translation_stats* stats;
+	print_mode print;
+	// dead register writes are left out, from a liveness analysis of the input
+	bool use_liveness;
+	// a counter per labeled block, dumped when main returns
+	bool instrument;
+	// frame slots kept in spare registers, from frame_promotion
+	bool promote;
+	// indexed addresses still held in an address register are not computed again, from address_reuse
+	bool reuse_addresses;
+	// only the procedures reachable from this label are translated, all of them when empty
+	string entry;
+
+	// size in instructions of the two print forms, which decide PRINT_AUTO
+	static const size_t INLINE_PRINT_SIZE = 6;
+	static const size_t CALL_PRINT_SIZE = 3;
+	static const size_t PRINT_ROUTINE_SIZE = 6;
+	const string PRINT_ROUTINE_LABEL = "__print_line";
+
+	const string COUNTERS_LABEL = "__block_counts";
+	const string COUNTER_PREFIX = "__count_";
+	const string DUMP_ROUTINE_LABEL = "__dump_block_counts";
+	const string DUMP_LOOP_LABEL = "__dump_block_counts_loop";
+	const string SAVED_RA_LABEL = "__instrument_ra";
 
 	const string WRONG_INSTRUCTION_MESG = "Wrong input instruction\n";
 
     /** instruction translation functions **/
-    string translate_movl(instruction* inst);
-    string translate_addl_andl_xorl_orl(instruction* inst);
-    string translate_subl(instruction* inst);
-    string translate_imull(instruction* inst);
-    string translate_idivl(instruction* inst);
-    string translate_sall_or_shll(instruction* inst);
-    string translate_sarl(instruction* inst);
-    string translate_shrl(instruction* inst);
-    string translate_incl(instruction* inst);
-    string translate_decl(instruction* inst);
-    string translate_negl(instruction* inst);
-    string translate_notl(instruction* inst);
-	string translate_pushl(instruction* inst);
-	string translate_batch_pushl(vector<instruction*> instructions);
-	string translate_popl(instruction* inst);
-	string translate_call(instruction* inst);
-	string translate_call_with_arguments(vector<instruction*> instructions, int argument_count);
-	string translate_jmp(instruction* inst);
-	string translate_cmpl_j(instruction* cmpl_inst, instruction* j_inst);
-    string translate_prn(instruction* inst);
-    string translate_int(instruction* inst);
-
-	string translate_procedure_head();
-	string translate_procedure_end();
-
-
-	/** addressing helper functions **/
-	bool is_immediate(string operand);
-	bool is_register(string operand);
-	bool is_indirect(string operand);
-	bool is_absolute(string operand);
-	bool is_indexed(string operand);
-	bool is_scaled_indexed(string operand);
-
-	string map_indirect(string operand);
-	string map_immediate(string operand);
-
-	string address_absolute(string& translated_insts, string operand);
-	string address_indexed(string& translated_insts, string operand);
-	string address_scaled_indexed(string& translated_insts, string operand);
+    void translate_movl(instruction inst, emitter& out);
+    void translate_addl_andl_xorl_orl(instruction inst, emitter& out);
+    void translate_subl(instruction inst, emitter& out);
+    void translate_imull(instruction inst, emitter& out);
+    void translate_idivl(instruction inst, emitter& out);
+    void translate_sall_or_shll(instruction inst, emitter& out);
+    void translate_sarl(instruction inst, emitter& out);
+    void translate_shrl(instruction inst, emitter& out);
+    void translate_incl(instruction inst, emitter& out);
+    void translate_decl(instruction inst, emitter& out);
+    void translate_negl(instruction inst, emitter& out);
+    void translate_notl(instruction inst, emitter& out);
+	void translate_pushl(instruction inst, emitter& out);
+	void translate_batch_pushl(instruction_iter first, instruction_iter last, emitter& out);
+	void translate_popl(instruction inst, emitter& out);
+	void translate_call(instruction inst, emitter& out);
+	void translate_call_with_arguments(instruction_iter first, int argument_count, emitter& out);
+	void translate_jmp(instruction inst, emitter& out);
+	void translate_cmpl_j(instruction cmpl_inst, instruction j_inst, emitter& out);
+    void translate_prn(instruction inst, emitter& out);
+    void translate_int(instruction inst, emitter& out);
+    void translate_print(instruction inst, const string& value_register, emitter& out);
+    void translate_print_routine(emitter& out);
+    bool use_print_routine(const program& prog);
+
+	void translate_procedure_head(emitter& out);
+	void translate_procedure_end(emitter& out);
+	void translate_wrong_instruction(emitter& out);
+
+	/** promoted frame slots **/
+	const frame_plan* promoted_frame(instruction inst);
+	const string* promoted_register(instruction inst, const operand_desc& operand);
+	void translate_frame_setup(instruction inst, emitter& out);
+	void translate_frame_restore(instruction inst, emitter& out);
+
+	/** block execution counters **/
+	void collect_counter_labels(index_range<block> blocks, vector<string>& labels);
+	void translate_data(emitter& out);
+	void translate_counters(const vector<string>& labels, emitter& out);
+	void translate_block_counter(text_ref label, emitter& out);
+	void translate_dump_routine(size_t counter_count, emitter& out);
+
+	/** block translation **/
+	void translate_block_head(block block, bool& is_procedure_head, text_ref& procedure_name, emitter& out);
+	void translate_sequential(index_range<block> blocks, emitter& out);
+	bool translate_block(block block, emitter& out);
+	bool translate_block_end(block block, bool is_procedure_head, text_ref procedure_name, emitter& out);
+	void translate_range(index_range<block> blocks, translated_range& range);
+	void translate_parallel(index_range<block> blocks, thread_pool& pool, emitter& out);
+	void translate_procedures(index_range<block> blocks, vector<cached_procedure>& procedures,
+		const string& options, thread_pool* pool, emitter& out);
+	void reachable_procedures(parser& parser, vector<cached_procedure>& procedures, vector<cached_procedure>& skipped);
+	void translate_procedure(index_range<block> blocks, emitter& out);
+	void split_procedures(index_range<block> blocks, vector<cached_procedure>& procedures);
+	void translate_cached_procedure(index_range<block> blocks, cached_procedure& procedure);
+	string cache_options(bool print_routine, bool streamed);
+	string cache_key(index_range<block> blocks, const string& options);
+
+	/** dispatch handlers **/
+	template <void (translator::*translate)(instruction, emitter&)>
+	void dispatch_single(instruction_iter& iter, instruction_iter end, emitter& out);
+	void dispatch_pushl(instruction_iter& iter, instruction_iter end, emitter& out);
+	void dispatch_leave(instruction_iter& iter, instruction_iter end, emitter& out);
+	void dispatch_cmpl(instruction_iter& iter, instruction_iter end, emitter& out);
+	void dispatch_skip(instruction_iter& iter, instruction_iter end, emitter& out);
+
+
+	/** addressing helper functions, the results are views into the input or registers_map **/
+	mips_operand map_indirect(const operand_desc& operand);
+	mips_operand map_immediate(const operand_desc& operand);
+	mips_operand map_compare_operand(instruction inst, const operand_desc& operand);
+
+	mips_operand address_memory(instruction inst, emitter& out, const operand_desc& operand);
+	mips_operand address_absolute(emitter& out, const operand_desc& operand);
+	mips_operand address_indexed(instruction inst, emitter& out, const operand_desc& operand);
+	mips_operand address_scaled_indexed(instruction inst, emitter& out, const operand_desc& operand);
 
 public:
     translator();
-    string translate_IA32_to_MIPS(parser parser);
+    // peephole optimizer applied to everything translated afterwards, NULL
+    // (the default) turns it off. Not owned
+    void set_optimizer(peephole* optimizer);
+    void set_print_mode(print_mode mode);
+    // .set noreorder output with the delay slots filled by scheduler, which
+    // also gets the slots of each procedure. NULL (the default) leaves the
+    // slots to the assembler. Not owned
+    void set_scheduler(delay_slot_scheduler* scheduler);
+    // on by default
+    void set_liveness(bool enabled);
+    // a cache to take the translation of unchanged procedures from, and to
+    // add the others to. NULL (the default) translates everything. Not owned
+    void set_cache(translation_cache* cache);
+    // counts of the instructions translated, the fallbacks taken and the time
+    // spent, added to from every translation. NULL (the default) counts
+    // nothing. Not owned
+    void set_stats(translation_stats* stats);
+    // translates only the procedures reachable from label through calls,
+    // jumps and the fall-through of code without .end, in the order they are
+    // reached; the others are listed in the stats. Empty (the default)
+    // translates every procedure in file order
+    void set_entry(const string& label);
+    translation_stats* get_stats() const;
+    // counts how often each labeled block is entered in the generated code,
+    // and prints the counts when main returns. Off by default
+    void set_instrument(bool enabled);
+    bool get_instrument() const;
+    // keeps the %ebp slots whose address cannot escape in registers for the
+    // whole procedure, see promotion.h. Off by default
+    void set_promotion(bool enabled);
+    // computes the address of an indexed operand only when no address
+    // register holds it from earlier in the block, see addressing.h. Off by default
+    void set_address_reuse(bool enabled);
+    // one line per counter: its index, the block label and the label's line
+    // in the input. Indices start at first_index, e.g. past the procedures a
+    // stream has already written
+    void write_block_map(parser& parser, ostream& os, size_t first_index = 0);
+    // writes the translation to os as it goes. The translator is not modified,
+    // so threads can share one instance. With a pool, runs of procedures are
+    // translated concurrently and written out in their original order
+    void translate_IA32_to_MIPS(parser& parser, ostream& os, thread_pool* pool = NULL);
+    // the same for a parser reading a stream, writing each procedure out as
+    // soon as its ret is read and before the next one is parsed. With
+    // --instrument, the counters of each procedure go to block_map as it is
+    // read, when one is given
+    void translate_stream(parser& parser, ostream& os, ostream* block_map = NULL);
     ~translator();
 };
 #endif
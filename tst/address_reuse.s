@@ -0,0 +1,135 @@
+# indexed addresses that --reuse-addresses computes once per block, and
+# what must make the translation compute one again: its base or index
+# written, $s6 used by imull or an absolute operand, a call or a prn, and
+# fewer address registers in a procedure --promote keeps arguments in
+
+# 4(%edi,%ebx,8) = (%edi,%ebx,8) with %ebx = 1: a[3] = a[2], computing
+# its address into $s6 like its caller
+clobber:
+	pushl %ebp
+	movl %esp, %ebp
+	movl 8(%ebp), %edi
+	movl $1, %ebx
+	movl (%edi, %ebx, 8), %eax
+	movl %eax, 4(%edi, %ebx, 8)
+	leave
+	ret
+
+# the sum of 12(%ebp) * a[i] + b[i] for i below 16(%ebp), storing each
+# into c[i]; the two arguments read in the loop are promoted
+weigh:
+	pushl %ebp
+	movl %esp, %ebp
+	movl 8(%ebp), %esi
+	movl %esi, %edi
+	addl $64, %edi
+	movl $0, %ecx
+	movl $0, %ebx
+weigh_loop:
+	movl (%esi, %ecx, 4), %eax
+	movl 12(%ebp), %edx
+	imull %edx, %eax
+	movl (%edi, %ecx, 4), %edx
+	addl %edx, %eax
+	movl %eax, 128(%esi, %ecx, 4)
+	movl (%edi, %ecx, 4), %edx
+	addl %edx, %ebx
+	addl %eax, %ebx
+	incl %ecx
+	movl 16(%ebp), %edx
+	cmpl %edx, %ecx
+	jl weigh_loop
+	movl %ebx, %eax
+	leave
+	ret
+
+main:
+	pushl %ebp
+	movl %esp, %ebp
+	subl $256, %esp
+	movl %esp, %esi
+	movl $0, %ecx
+main_fill:
+	movl %ecx, (%esi, %ecx, 4)
+	movl %ecx, %eax
+	addl %ecx, %eax
+	movl %eax, 64(%esi, %ecx, 4)
+	incl %ecx
+	cmpl $8, %ecx
+	jl main_fill
+
+	# the index written between two uses, also by the load itself
+	movl $3, %ecx
+	movl (%esi, %ecx, 4), %eax
+	incl %ecx
+	movl %eax, (%esi, %ecx, 4)
+	movl (%esi, %ecx, 4), %ecx
+	movl 64(%esi, %ecx, 4), %eax
+	prn %eax
+	# the base written
+	movl $1, %ecx
+	movl (%esi, %ecx, 4), %eax
+	addl $4, %esi
+	movl (%esi, %ecx, 4), %edx
+	subl $4, %esi
+	addl %edx, %eax
+	prn %eax
+
+	# $s6 used by an imull by 5 and by an absolute operand, the first word
+	# of .data (the newline)
+	movl $2, %ecx
+	movl (%esi, %ecx, 4), %eax
+	imull $5, %eax
+	movl %eax, (%esi, %ecx, 4)
+	movl 268500992, %edx
+	movl %edx, 4(%esi, %ecx, 4)
+	movl (%esi, %ecx, 4), %eax
+	movl 4(%esi, %ecx, 4), %edx
+	addl %edx, %eax
+	prn %eax
+
+	# a call and a prn between two uses
+	movl $5, %ecx
+	movl $9, (%esi, %ecx, 4)
+	pushl %esi
+	call clobber
+	movl (%esi, %ecx, 4), %eax
+	prn %eax
+	movl (%esi, %ecx, 4), %edx
+	addl %edx, %eax
+	prn %eax
+
+	# more addresses than address registers, the least recently used
+	# replaced; (%esi,%ecx) is (%esi,%ecx,1)
+	movl %esi, %edi
+	addl $128, %edi
+	movl $4, %ecx
+	movl $8, %edx
+	movl $1, (%esi, %ecx, 1)
+	movl $2, 64(%esi, %ecx, 2)
+	movl $3, 128(%esi, %ecx, 4)
+	movl $4, 96(%esi, %ecx, 8)
+	movl $5, 160(%esi, %edx, 1)
+	movl $6, 192(%esi, %edx, 2)
+	movl $7, 8(%esi, %edx, 4)
+	movl $8, 176(%esi, %edx, 8)
+	movl $9, 48(%edi, %ecx, 4)
+	movl (%esi, %ecx), %eax
+	movl 64(%esi, %ecx, 2), %edx
+	addl %edx, %eax
+	movl 128(%esi, %ecx, 4), %edx
+	addl %edx, %eax
+	movl 96(%esi, %ecx, 8), %edx
+	addl %edx, %eax
+	movl 48(%edi, %ecx, 4), %edx
+	addl %edx, %eax
+	prn %eax
+
+	pushl $8
+	pushl $3
+	pushl %esi
+	call weigh
+	prn %eax
+	addl $256, %esp
+	leave
+	ret
@@ -0,0 +1,130 @@
+# frame slots that --promote keeps in registers: locals in loops with a
+# call around them, a recursive procedure's locals, read-only arguments.
+# The locals are freed with addl before leave, which leaves the stack
+# pointer where the translation of leave expects it
+square:
+	pushl %ebp
+	movl %esp, %ebp
+	movl 8(%ebp), %eax
+	imull %eax, %eax
+	leave
+	ret
+
+# the sum of the squares below 8(%ebp), with an inner loop whose slots
+# outnumber the saved registers, so one is spilled around the call
+squares:
+	pushl %ebp
+	movl %esp, %ebp
+	subl $24, %esp
+	movl $0, -4(%ebp)
+	movl $0, -8(%ebp)
+	movl $0, -12(%ebp)
+	movl $0, -16(%ebp)
+	movl $0, -24(%ebp)
+	addl $7, -24(%ebp)
+squares_outer:
+	movl -8(%ebp), %eax
+	pushl %eax
+	call square
+	addl -4(%ebp), %eax
+	movl %eax, -4(%ebp)
+	movl $0, -20(%ebp)
+squares_inner:
+	movl -12(%ebp), %eax
+	addl -20(%ebp), %eax
+	movl %eax, -12(%ebp)
+	movl -16(%ebp), %edx
+	incl %edx
+	movl %edx, -16(%ebp)
+	movl -24(%ebp), %edx
+	xorl $1, %edx
+	movl %edx, -24(%ebp)
+	movl -20(%ebp), %ecx
+	incl %ecx
+	movl %ecx, -20(%ebp)
+	cmpl $3, %ecx
+	jl squares_inner
+	movl -8(%ebp), %ecx
+	incl %ecx
+	movl %ecx, -8(%ebp)
+	movl 8(%ebp), %edx
+	cmpl %edx, %ecx
+	jl squares_outer
+	movl -12(%ebp), %eax
+	prn %eax
+	movl -16(%ebp), %eax
+	prn %eax
+	movl -24(%ebp), %eax
+	prn %eax
+	movl -4(%ebp), %eax
+	addl $24, %esp
+	leave
+	ret
+
+# 6 for each level down to 0, the locals surviving the recursive call
+depth:
+	pushl %ebp
+	movl %esp, %ebp
+	subl $8, %esp
+	movl $0, -4(%ebp)
+	movl $0, -8(%ebp)
+depth_loop:
+	movl -4(%ebp), %eax
+	addl -8(%ebp), %eax
+	movl %eax, -4(%ebp)
+	movl -8(%ebp), %ecx
+	incl %ecx
+	movl %ecx, -8(%ebp)
+	cmpl $4, %ecx
+	jl depth_loop
+	movl 8(%ebp), %eax
+	cmpl $0, %eax
+	je depth_end
+	decl %eax
+	pushl %eax
+	call depth
+	addl -4(%ebp), %eax
+	movl %eax, -4(%ebp)
+depth_end:
+	movl -4(%ebp), %eax
+	prn %eax
+	addl $8, %esp
+	leave
+	ret
+
+# 12(%ebp) added up 8(%ebp) times
+scale:
+	pushl %ebp
+	movl %esp, %ebp
+	subl $8, %esp
+	movl $0, -4(%ebp)
+	movl 8(%ebp), %ecx
+	movl %ecx, -8(%ebp)
+scale_loop:
+	movl -4(%ebp), %eax
+	addl 12(%ebp), %eax
+	movl %eax, -4(%ebp)
+	decl -8(%ebp)
+	movl -8(%ebp), %edx
+	cmpl $0, %edx
+	jg scale_loop
+	movl -4(%ebp), %eax
+	addl $8, %esp
+	leave
+	ret
+
+main:
+	pushl %ebp
+	movl %esp, %ebp
+	pushl $4
+	call squares
+	prn %eax
+	pushl $3
+	call depth
+	prn %eax
+	pushl $3
+	pushl $5
+	call scale
+	prn %eax
+	leave
+	ret
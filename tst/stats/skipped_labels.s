@@ -0,0 +1,25 @@
+# procedures main does not reach, their labels need escaping in --stats=json
+main:
+	pushl %ebp
+	movl %esp, %ebp
+	movl $1, %eax
+	leave
+	ret
+
+quote"d:
+	pushl %ebp
+	movl %esp, %ebp
+	leave
+	ret
+
+back\slash:
+	pushl %ebp
+	movl %esp, %ebp
+	leave
+	ret
+
+controlchar:
+	pushl %ebp
+	movl %esp, %ebp
+	leave
+	ret